@@ -0,0 +1,327 @@
+#!/usr/bin/env python2
+
+# Runs pipeline.py over a benchmark set under time and memory limits and
+# records one CSV row per formula. The logs of the published runs in logs/
+# are turned into the same format, so a run can be compared against them.
+#
+#   benchmark.py [<option> ...] <set> <csv>
+#   benchmark.py --baseline[=<tool>] <set> <csv>
+#
+# <set> is parity, qbfeval20, a directory of formulas, a list of formula
+# files, or a single formula. The qbfeval20 formulas are not shipped; they
+# are looked up in the directory given by --formulas.
+
+import sys, os, shutil, errno, subprocess, signal, time, resource, gzip, csv
+
+home = os.path.dirname(os.path.abspath(__file__)) + "/"
+root = os.path.dirname(os.path.dirname(os.path.abspath(__file__))) + "/"
+pipeline = home + "pipeline.py"
+
+time_limit = 900      # seconds of wall-clock time per formula
+space_limit = 50000   # MB of address space per process
+formulas = None
+logs = None
+baseline = None
+compare = None
+pipeline_args = []
+
+# Pipeline stages and the runlim log entries that correspond to them
+stages = [("solving", ["Calling QBF solver"], ["solving-time"]),
+          ("proof", ["Calling SAT solver", "Checking unsat proof", "Producing FERP trace"],
+           ["proof-gen-satsolver", "tracecheck-time", "toferp-time"]),
+          ("extraction", ["Checking FERP trace and extracting strategy",
+                          "Checking proof and extracting strategy"],
+           ["ferpcheck-time", "ferpcert-time", "qrpcheck-time", "qrpcert-time"]),
+          ("merging", ["Producing CNF"], ["merging-time", "aigtocnf"]),
+          ("checking", ["Check validity of certificate"], ["final-check-time"])]
+
+fields = ["name", "status", "real", "space"] + [s[0] for s in stages] + \
+         ["ferp_size", "aig_size", "aig_ands", "merged_cnf_size"]
+
+
+def assure_dir(path):
+  try:
+    if not os.path.exists(path):
+      os.makedirs(path)
+  except OSError as e:
+    if e.errno != errno.EEXIST:
+      raise e
+
+
+def usage():
+  print("usage: benchmark.py [ <option> ... ] <set> <csv>\n"
+        "\n"
+        "  --time=<sec>       wall-clock limit per formula (default 900)\n"
+        "  --space=<MB>       address space limit per process (default 50000)\n"
+        "  --formulas=<dir>   directory with the formulas of a list\n"
+        "  --logs=<dir>       keep the output of each pipeline run\n"
+        "  --pipeline=<arg>   pass <arg> to pipeline.py (repeatable)\n"
+        "  --compare=<csv>    compare with a previous run or baseline\n"
+        "  --baseline[=<tool>]\n"
+        "                     write the published results of <tool> (ferpert,\n"
+        "                     qbfcert or caqe; default ferpert) instead of running")
+  sys.exit(1)
+
+
+def parse_args():
+  global time_limit, space_limit, formulas, logs, baseline, compare
+  args = []
+  for arg in sys.argv[1:]:
+    if arg.startswith("--time="):
+      time_limit = float(arg[len("--time="):])
+    elif arg.startswith("--space="):
+      space_limit = int(arg[len("--space="):])
+    elif arg.startswith("--formulas="):
+      formulas = os.path.abspath(arg[len("--formulas="):])
+    elif arg.startswith("--logs="):
+      logs = os.path.abspath(arg[len("--logs="):])
+    elif arg.startswith("--pipeline="):
+      pipeline_args.append(arg[len("--pipeline="):])
+    elif arg.startswith("--compare="):
+      compare = arg[len("--compare="):]
+    elif arg == "--baseline":
+      baseline = "ferpert"
+    elif arg.startswith("--baseline="):
+      baseline = arg[len("--baseline="):]
+    elif arg.startswith("-"):
+      usage()
+    else:
+      args.append(arg)
+  if len(args) != 2:
+    usage()
+  return args[0], args[1]
+
+
+def name_of(path):
+  return ".".join(os.path.basename(path).split(".")[:-1])
+
+
+def get_formulas(bench_set):
+  # Returns the (name, path) pairs of a benchmark set
+  if bench_set == "parity":
+    bench_set = root + "benchmarks/parity"
+  elif bench_set == "qbfeval20":
+    bench_set = root + "benchmarks/qbfeval20.txt"
+  if os.path.isdir(bench_set):
+    return [(name_of(f), os.path.join(bench_set, f)) for f in sorted(os.listdir(bench_set))
+            if f.endswith(".qdimacs") or f.endswith(".qdimacs.gz")]
+  if bench_set.endswith(".txt"):
+    base = formulas or os.path.dirname(os.path.abspath(bench_set))
+    res = []
+    with open(bench_set) as f:
+      for line in f:
+        line = line.strip()
+        if line.endswith(".qdimacs") or line.endswith(".qdimacs.gz"):
+          res.append((name_of(line), os.path.join(base, line)))
+    return res
+  return [(name_of(bench_set), os.path.abspath(bench_set))]
+
+
+def file_size(path):
+  return os.path.getsize(path) if os.path.isfile(path) else ""
+
+
+def aiger_info(path):
+  # Size and number of AND gates of a (gzipped) ASCII AIGER file
+  if not os.path.isfile(path):
+    return "", ""
+  size, ands = 0, ""
+  with gzip.open(path, "rb") as f:
+    header = f.readline()
+    if header.startswith(b"aag") or header.startswith(b"aig"):
+      ands = int(header.split()[-1])
+    size = len(header)
+    chunk = f.read(1 << 20)
+    while chunk:
+      size += len(chunk)
+      chunk = f.read(1 << 20)
+  return size, ands
+
+
+def limit_process():
+  os.setsid()
+  space = space_limit * (1 << 20)
+  resource.setrlimit(resource.RLIMIT_AS, (space, space))
+
+
+def run_formula(name, path, work_dir):
+  # Runs the pipeline on one formula like runlim: the process group is
+  # killed at the time limit, and the peak RSS is that of the largest
+  # process of the run
+  row = dict((f, "") for f in fields)
+  row["name"] = name
+  if not os.path.exists(path):
+    row["status"] = "missing"
+    return row
+  output = work_dir + name + ".aag"
+  times = work_dir + name + ".times"
+  log_path = os.path.join(logs, name + ".log") if logs else work_dir + name + ".log"
+  log = open(log_path, "wb")
+  cmd = [sys.executable, pipeline] + pipeline_args + ["--times=" + times, path, output]
+  start = time.time()
+  proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT, preexec_fn=limit_process)
+  timeout = False
+  while True:
+    pid, status, usage = os.wait4(proc.pid, os.WNOHANG)
+    if pid:
+      break
+    if time.time() - start > time_limit and not timeout:
+      timeout = True
+      os.killpg(proc.pid, signal.SIGKILL)
+    time.sleep(0.05)
+  proc.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+  log.close()
+  row["real"] = "%.2f" % (time.time() - start)
+  row["space"] = usage.ru_maxrss // 1024
+  try:
+    os.killpg(proc.pid, signal.SIGKILL)  # stray children of a failed stage
+  except OSError:
+    pass
+
+  if timeout:
+    row["status"] = "out of time"
+  elif proc.returncode == 0:
+    row["status"] = "ok"
+  elif proc.returncode == 1:
+    row["status"] = "true"
+  else:
+    row["status"] = "failed %d" % proc.returncode
+    with open(log_path, "rb") as f:
+      if b"out of memory" in f.read().lower():
+        row["status"] = "out of memory"
+
+  if os.path.isfile(times):
+    with open(times) as f:
+      for line in f:
+        message, seconds = line.rstrip("\n").split("\t")
+        for stage, messages, _ in stages:
+          if message in messages:
+            row[stage] = "%.2f" % (float(row[stage] or 0) + float(seconds))
+
+  tmp_dir = home + "tmp/tmp-%d/" % proc.pid
+  row["ferp_size"] = file_size(tmp_dir + "tmp.ferp") or file_size(tmp_dir + "tmp.lrat")
+  row["merged_cnf_size"] = file_size(tmp_dir + "tmp.cnf2")
+  row["aig_size"], row["aig_ands"] = aiger_info(output + ".gz")
+  shutil.rmtree(tmp_dir, ignore_errors=True)
+  for f in (output, output + ".gz", times, work_dir + name + ".log"):
+    if os.path.exists(f):
+      os.remove(f)
+  return row
+
+
+def parse_log(name, log_path, err_path):
+  # Reads the runlim statistics and sizes of a published run
+  row = dict((f, "") for f in fields)
+  row["name"] = name
+  stage_of = {}
+  for stage, _, entries in stages:
+    for entry in entries:
+      stage_of[entry] = stage
+  lines = []
+  for path in (log_path, err_path):
+    if os.path.isfile(path):
+      with open(path) as f:
+        lines += f.read().splitlines()
+  for line in lines:
+    if line.startswith("[runlim] status:"):
+      row["status"] = line.split(":", 1)[1].strip()
+    elif line.startswith("[runlim] real:"):
+      row["real"] = line.split()[2]
+    elif line.startswith("[runlim] space:"):
+      row["space"] = line.split()[2]
+    elif line.startswith("ferp-size:"):
+      row["ferp_size"] = line.split()[1]
+    elif line.startswith("aig-size:") or line.startswith("certificiate-size:"):
+      row["aig_size"] = line.split()[1]
+    elif line.startswith("aig-header:") or line.startswith("certificate-header:"):
+      row["aig_ands"] = line.split()[-1]
+    elif line.startswith("merged-cnf-size:"):
+      row["merged_cnf_size"] = line.split()[1]
+    elif ":" in line or line.startswith("merging-time"):
+      key, _, value = line.replace(":", " ").partition(" ")
+      if key in stage_of and value.strip():
+        stage = stage_of[key]
+        row[stage] = "%.2f" % (float(row[stage] or 0) + float(value.split()[0]))
+  if row["status"] == "ok" and "VALID" not in lines and \
+     not any(l.endswith(": VALID") for l in lines):
+    # Runs that only solved the formula without certifying it
+    row["status"] = "failed"
+    if "solving-result: 10" in lines or any("QBF is true" in l for l in lines):
+      row["status"] = "true"
+    elif "solving-result: 20" in lines:
+      row["status"] = "false"
+  return row
+
+
+def get_baseline(bench_set, tool):
+  log_dir = root + "logs/%s/%s/" % (os.path.basename(bench_set.rstrip("/")), tool)
+  if not os.path.isdir(log_dir):
+    raise OSError("No logs at %s" % log_dir)
+  names = sorted(set(name_of(f) for f in os.listdir(log_dir)))
+  return [parse_log(n, log_dir + n + ".log", log_dir + n + ".err") for n in names]
+
+
+def read_csv(path):
+  with open(path) as f:
+    return dict((row["name"], row) for row in csv.DictReader(f))
+
+
+def write_csv(path, rows):
+  with open(path, "w") as f:
+    writer = csv.DictWriter(f, fieldnames=fields, lineterminator="\n")
+    writer.writeheader()
+    for row in rows:
+      writer.writerow(row)
+
+
+def print_comparison(rows, reference):
+  # Per formula status and ratios of time and AIG size, then totals over the
+  # formulas that are solved in both runs
+  print("%-50s %14s %14s %8s %8s" % ("formula", "status", "reference", "time", "gates"))
+  common, solved, ref_solved = [], 0, 0
+  for row in rows:
+    ref = reference.get(row["name"])
+    ref_status = ref["status"] if ref else "-"
+    solved += row["status"] == "ok"
+    ref_solved += ref_status == "ok"
+    time_ratio = gate_ratio = ""
+    if row["status"] == "ok" and ref_status == "ok":
+      common.append((row, ref))
+      if float(ref["real"] or 0) > 0:
+        time_ratio = "%.2fx" % (float(row["real"]) / float(ref["real"]))
+      if ref["aig_ands"] and row["aig_ands"] and int(ref["aig_ands"]) > 0:
+        gate_ratio = "%.2fx" % (float(row["aig_ands"]) / int(ref["aig_ands"]))
+    print("%-50s %14s %14s %8s %8s" % (row["name"][:50], row["status"], ref_status,
+                                       time_ratio, gate_ratio))
+  total = sum(float(r["real"]) for r, _ in common)
+  ref_total = sum(float(r["real"] or 0) for _, r in common)
+  print("solved: %d (reference %d), time on %d common: %.2f s (reference %.2f s)" %
+        (solved, ref_solved, len(common), total, ref_total))
+
+
+def main():
+  bench_set, csv_path = parse_args()
+  if baseline:
+    rows = get_baseline(bench_set, baseline)
+  else:
+    if not os.path.exists(pipeline):
+      raise OSError("Pipeline %s does not exist" % pipeline)
+    if logs:
+      assure_dir(logs)
+    work_dir = home + "tmp/benchmark-%d/" % os.getpid()
+    assure_dir(work_dir)
+    rows = []
+    for name, path in get_formulas(bench_set):
+      sys.stdout.write("Running %s ... " % name)
+      sys.stdout.flush()
+      rows.append(run_formula(name, path, work_dir))
+      print("%s (%s s)" % (rows[-1]["status"], rows[-1]["real"]))
+      write_csv(csv_path, rows)
+    shutil.rmtree(work_dir, ignore_errors=True)
+  write_csv(csv_path, rows)
+  if compare:
+    print_comparison(rows, read_csv(compare))
+
+
+if __name__ == '__main__':
+  main()
@@ -8,10 +8,18 @@
 
 #include "admin.h"
 
-int num_lits, size_lits, * lits;
+TLS int num_lits, size_lits, * lits;
+TLS jmp_buf *die_jump;
+TLS char die_message [256];
 
 void die (const char * fmt, ...) {
   va_list ap;
+  if (die_jump) {
+    va_start (ap, fmt);
+    vsnprintf (die_message, sizeof die_message, fmt, ap);
+    va_end (ap);
+    longjmp (*die_jump, 1);
+  }
   fputs ("*** ferpcert: ", stderr);
   va_start (ap, fmt);
   vfprintf (stderr, fmt, ap);
@@ -42,3 +50,9 @@ void push_literal (int lit) {
   if (size_lits == num_lits) enlarge_lits ();
   lits[num_lits++] = lit;
 }
+
+void admin_state (Visit visit) {
+  VISIT (num_lits);
+  VISIT (size_lits);
+  VISIT (lits);
+}
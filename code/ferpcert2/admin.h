@@ -1,6 +1,16 @@
 #ifndef ADMIN_H
 #define ADMIN_H
 
+#include <setjmp.h>
+#include <stddef.h>
+
+/* The state of all modules is thread-local. Each module lists it in a
+ * <module>_state function, through which libferpcert.c swaps the state of
+ * its contexts in and out. */
+#define TLS __thread
+typedef void (*Visit) (void *, size_t);
+#define VISIT(X) visit (&(X), sizeof (X))
+
 #define NEWN(P,N) \
   do { \
     size_t NEWN_BYTES = (N) * sizeof *(P); \
@@ -29,9 +39,12 @@
 #define DEL(P) DELN((P),1)
 
 void die (const char *, ...); 
+extern TLS jmp_buf *die_jump;     // if set, die returns there with the message
+extern TLS char die_message [256];
 
-extern int num_lits, size_lits, * lits;
+extern TLS int num_lits, size_lits, * lits;
 void push_literal (int); 
 void release_lits (); 
+void admin_state (Visit);
 
 #endif 
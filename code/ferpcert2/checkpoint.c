@@ -0,0 +1,224 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "checkpoint.h"
+#include "uset.h"
+
+/* Snapshots of the extraction (--checkpoint, --resume). A snapshot holds
+ * the index of the last processed proof clause, the labels of the clauses
+ * whose children are not all processed yet, and the gates of the AIG. It is
+ * written as native ints:
+ *
+ *   magic version fingerprint last lhs_aux num_ands
+ *   num_ands x (lhs rhs0 rhs1)
+ *   num_labels
+ *   num_labels x (clause num_universals universals... aig_labels...)
+ *
+ * The fingerprint hashes the prefix and matrix of the QBF and the expansion
+ * variables and clauses of the proof, so a snapshot is only resumed with
+ * the same inputs and options. The hash table of the AIG is
+ * rebuilt when the gates are added again. */
+
+#define CHECKPOINT_MAGIC 0x46455250
+#define CHECKPOINT_VERSION 2
+
+TLS char *checkpoint_file;
+TLS int checkpoint_interval = 600;
+TLS int resume;
+
+static TLS time_t last_checkpoint;
+
+static unsigned fingerprint () {
+  unsigned h = num_vars * 17 ^ num_clauses, sum;
+  int i, j;
+
+  for (i = 1; i <= num_vars; i++) {
+    Scope *s = vars [i].scope;
+    h = (h * 31) ^ (s ? 2 * s->order + (s->type == FORALL) : -1);
+  }
+  for (i = 0; i < orig_clauses; i++) {
+    h = (h * 31) ^ clauses [i].size;
+    for (j = 0; j < clauses [i].size; j++) h = (h * 31) ^ clauses [i].lits [j];
+  }
+
+  // Extraction sorts annotations in place, so their order is not hashed
+  for (i = 0; i < a_vars_size; i++) {
+    A_Var *av = a_vars + i;
+    for (j = 0, sum = 0; j < av->ann_size; j++)
+      sum += (unsigned) av->u_annotations [j] * 2654435761u;
+    h = (h * 31) ^ av->orig_ex_name;
+    h = (h * 31) ^ sum;
+  }
+
+  for (i = 0; i < num_p_clauses; i++) {
+    P_Clause *c = p_clauses + i;
+    if (!c->name) continue;
+    h = (h * 31) ^ i;
+    h = (h * 31) ^ c->p1;
+    h = (h * 31) ^ c->p2;
+    h = (h * 31) ^ c->pivot;
+    h = (h * 31) ^ c->size;
+    h = (h * 31) ^ c->chain_size;
+    for (j = 0; j < c->size; j++) h = (h * 31) ^ c->nodes [j];
+    for (j = 0; j < c->chain_size; j++) h = (h * 31) ^ c->chain [j];
+  }
+  return h;
+}
+
+int checkpoint_due () {
+  time_t now = time (NULL);
+  if (!last_checkpoint) last_checkpoint = now;
+  return now - last_checkpoint >= checkpoint_interval;
+}
+
+static void write_ints (FILE *f, int *p, int n) {
+  if (n && fwrite (p, sizeof (int), n, f) != (size_t) n)
+    die ("could not write checkpoint %s", checkpoint_file);
+}
+
+static void write_int (FILE *f, int x) {
+  write_ints (f, &x, 1);
+}
+
+// The temporary file a snapshot is written to before it replaces the last
+static char * tmp_file () {
+  char *tmp;
+  NEWN (tmp, strlen (checkpoint_file) + 5);
+  sprintf (tmp, "%s.tmp", checkpoint_file);
+  return tmp;
+}
+
+// Writes the snapshot after proof clause 'last' to a temporary file first,
+// so that an interrupted write leaves the previous snapshot intact
+void checkpoint_save (simpleaig *aig, int last) {
+  char *tmp = tmp_file ();
+  int i, num_labels = 0;
+  unsigned j;
+  FILE *f;
+
+  if (!(f = fopen (tmp, "wb"))) die ("could not write checkpoint %s", tmp);
+
+  write_int (f, CHECKPOINT_MAGIC);
+  write_int (f, CHECKPOINT_VERSION);
+  write_int (f, (int) fingerprint ());
+  write_int (f, last);
+  write_int (f, aig->lhs_aux);
+  write_int (f, aig->num_ands);
+  for (j = 0; j < aig->num_ands; j++) {
+    write_int (f, aig->ands [j].lhs);
+    write_int (f, aig->ands [j].rhs0);
+    write_int (f, aig->ands [j].rhs1);
+  }
+
+  for (i = 0; i <= last; i++)
+    if (p_clauses [i].uses) num_labels++;
+  write_int (f, num_labels);
+  for (i = 0; i <= last; i++) {
+    P_Clause *c = p_clauses + i;
+    if (!c->uses) continue;
+    write_int (f, i);
+    write_int (f, c->num_universals);
+    write_ints (f, c->universals, c->num_universals);
+    write_ints (f, c->aig_labels, c->num_universals);
+  }
+
+  if (fclose (f) || rename (tmp, checkpoint_file))
+    die ("could not write checkpoint %s", checkpoint_file);
+  free (tmp);
+  last_checkpoint = time (NULL);
+}
+
+static void read_ints (FILE *f, int *p, int n) {
+  if (n && fread (p, sizeof (int), n, f) != (size_t) n)
+    die ("truncated checkpoint %s", checkpoint_file);
+}
+
+static int read_int (FILE *f) {
+  int x;
+  read_ints (f, &x, 1);
+  return x;
+}
+
+// Restores the labels and gates of a snapshot and returns the index of the
+// last processed proof clause, or -1 if there is no snapshot yet
+int checkpoint_load (simpleaig *aig) {
+  int i, j, last, num_ands, num_labels, lhs, rhs0, rhs1;
+  FILE *f = fopen (checkpoint_file, "rb");
+  char *tmp = tmp_file ();
+
+  // Left behind by a run killed while saving
+  remove (tmp);
+  free (tmp);
+  last_checkpoint = time (NULL);
+  if (!f) return -1;
+  if (read_int (f) != CHECKPOINT_MAGIC || read_int (f) != CHECKPOINT_VERSION)
+    die ("invalid checkpoint %s", checkpoint_file);
+  if ((unsigned) read_int (f) != fingerprint ())
+    die ("checkpoint %s belongs to another QBF or proof", checkpoint_file);
+  last = read_int (f);
+  if (last < 0 || last >= num_p_clauses)
+    die ("invalid checkpoint %s", checkpoint_file);
+
+  aig->lhs_aux = read_int (f);
+  num_ands = read_int (f);
+  for (i = 0; i < num_ands; i++) {
+    lhs = read_int (f);
+    rhs0 = read_int (f);
+    rhs1 = read_int (f);
+    simpleaig_add_and (aig, lhs, rhs0, rhs1);
+  }
+
+  // Children up to 'last' have already used the labels of their parents
+  for (i = 0; i <= last; i++) {
+    P_Clause *c = p_clauses + i;
+    if (!c->uses || !c->p2) continue;
+    if (c->chain) {
+      for (j = 0; j < c->chain_size; j++) p_clauses [c->chain[j]].uses--;
+    } else {
+      p_clauses [c->p1].uses--;
+      p_clauses [c->p2].uses--;
+    }
+  }
+
+  num_labels = read_int (f);
+  for (i = 0; i < num_labels; i++) {
+    int n, *universals;
+    P_Clause *c = p_clauses + read_int (f);
+    if (c < p_clauses || c > p_clauses + last || !c->uses)
+      die ("invalid checkpoint %s", checkpoint_file);
+    n = read_int (f);
+    if (n < 0 || n > universal_vars) die ("invalid checkpoint %s", checkpoint_file);
+    universals = malloc (sizeof (int) * (n + 1));
+    c->aig_labels = malloc (sizeof (int) * (n + 1));
+    read_ints (f, universals, n);
+    read_ints (f, c->aig_labels, n);
+    c->uset = uset_intern (universals, n);
+    c->universals = usets [c->uset].vars;
+    c->num_universals = n;
+    c->leaf_label = 0;
+    free (universals);
+  }
+  fclose (f);
+  fprintf (stderr, "resuming extraction after proof clause %d of %d\n", last,
+           num_p_clauses);
+  return last;
+}
+
+// Removes the snapshot and a temporary file left behind once the strategy
+// is written
+void checkpoint_remove () {
+  char *tmp = tmp_file ();
+  remove (tmp);
+  free (tmp);
+  remove (checkpoint_file);
+}
+
+void checkpoint_state (Visit visit) {
+  VISIT (checkpoint_file);
+  VISIT (checkpoint_interval);
+  VISIT (resume);
+  VISIT (last_checkpoint);
+}
@@ -0,0 +1,19 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "formula.h"
+#include "admin.h"
+#include "proof.h"
+#include "simpleaig.h"
+
+extern TLS char *checkpoint_file;
+extern TLS int checkpoint_interval;
+extern TLS int resume;
+
+int checkpoint_due ();
+void checkpoint_save (simpleaig *, int);
+int checkpoint_load (simpleaig *);
+void checkpoint_remove ();
+void checkpoint_state (Visit);
+
+#endif
@@ -0,0 +1,182 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compress.h"
+
+/* Proof compression before extraction (--compress). Both algorithms work on
+ * the binary resolution DAG and only ever make resolvents smaller, so the
+ * result is a refutation of the same leaves in which every step still
+ * resolves on an expansion variable.
+ *
+ * RecycleUnits (Bar-Ilan et al. 2008): a step on the variable of a derived
+ * unit {l} that precedes it uses the unit in place of the parent containing l.
+ *
+ * LowerUnits (Fontaine et al. 2011): units with several children are removed
+ * from the DAG and resolved once each with the weakened root at the bottom,
+ * units closer to the root first.
+ *
+ * Afterwards the proof is reconstructed: resolvents are recomputed from their
+ * new parents, and a step whose parent lost the pivot literal is replaced by
+ * that parent. */
+
+static TLS int *subst;   // clause replacing each clause
+static TLS int *lowered; // literal of each lowered unit, 0 otherwise
+
+static int cmpfunc (const void * a, const void * b) {
+  const int *l1 = a, *l2 = b;
+  return lit2var (a_lit2var (*l1))->scope->order >
+         lit2var (a_lit2var (*l2))->scope->order;
+}
+
+static int contains (P_Clause *c, int lit) {
+  int i;
+  for (i = 0; i < c->size; i++)
+    if (c->nodes[i] == lit) return 1;
+  return 0;
+}
+
+static void set_resolvent (int cl) {
+  P_Clause *c = p_clauses + cl, *a = p_clauses + c->p1, *b = p_clauses + c->p2;
+  int i, lit, pivot = c->pivot;
+
+  assert (!num_lits);
+  for (i = 0; i < a->size; i++) {
+    lit = a->nodes[i];
+    if (lit == pivot) continue;
+    a_vars [abs(lit)].mark = lit;
+    push_literal (lit);
+  }
+  for (i = 0; i < b->size; i++) {
+    lit = b->nodes[i];
+    if (lit == -pivot || a_vars [abs(lit)].mark == lit) continue;
+    push_literal (lit);
+  }
+  for (i = 0; i < a->size; i++) a_vars [abs(a->nodes[i])].mark = 0;
+
+  free (c->nodes);
+  c->nodes = malloc (sizeof (int) * num_lits);
+  for (i = 0; i < num_lits; i++) c->nodes[i] = lits[i];
+  c->size = num_lits;
+  qsort (c->nodes, c->size, sizeof (int), cmpfunc);
+  num_lits = 0;
+}
+
+// Returns the clause that replaces 'cl' in the reconstructed proof
+static int reconstruct (int cl) {
+  P_Clause *c = p_clauses + cl;
+
+  c->p1 = lowered [c->p1] ? 0 : subst [c->p1];
+  c->p2 = lowered [c->p2] ? 0 : subst [c->p2];
+  if (!c->p1) return c->p2;
+  if (!c->p2) return c->p1;
+  if (!contains (p_clauses + c->p1, c->pivot)) return c->p1;
+  if (!contains (p_clauses + c->p2, -c->pivot)) return c->p2;
+  set_resolvent (cl);
+  return cl;
+}
+
+static int add_resolvent (int p1, int p2, int pivot) {
+  int cl = num_p_clauses++;
+
+  if (p_clauses_size <= cl) enlarge_proof_clauses (cl);
+  p_clauses [cl].name = cl;
+  p_clauses [cl].p1 = p1;
+  p_clauses [cl].p2 = p2;
+  p_clauses [cl].pivot = pivot;
+  set_resolvent (cl);
+  return cl;
+}
+
+int compress_proof () {
+  P_Clause *c;
+  int i, u, lit, root, before, after, res, recycled = 0, num_lowered = 0;
+  int *units;
+
+  for (i = 1; i <= p_empty_clause; i++) {
+    if (p_clauses [i].chain) {
+      fprintf (stderr, "proof compression skipped (resolution chains)\n");
+      return 0;
+    }
+  }
+
+  // RecycleUnits
+
+  before = trim_proof ();
+  root = p_empty_clause;
+  NEWN (units, a_vars_size);
+  for (i = 1; i <= root; i++) {
+    c = p_clauses + i;
+    if (c->uses && c->size == 1 && !units [abs(c->nodes[0])])
+      units [abs(c->nodes[0])] = i;
+  }
+  for (i = 1; i <= root; i++) {
+    c = p_clauses + i;
+    if (!c->uses || !c->p2) continue;
+    u = units [abs(c->pivot)];
+    if (!u || u >= i) continue;
+    if (p_clauses [u].nodes[0] == c->pivot && c->p1 != u) {
+      c->p1 = u;
+      recycled++;
+    } else if (p_clauses [u].nodes[0] == -c->pivot && c->p2 != u) {
+      c->p2 = u;
+      recycled++;
+    }
+  }
+  free (units);
+
+  // LowerUnits, except for the parents of the root
+
+  trim_proof ();
+  NEWN (subst, root + 1);
+  NEWN (lowered, root + 1);
+  for (i = 1; i < root; i++) {
+    c = p_clauses + i;
+    if (c->uses > 1 && c->size == 1 &&
+        i != p_clauses [root].p1 && i != p_clauses [root].p2)
+      lowered [i] = c->nodes[0];
+  }
+
+  for (i = 1; i <= root; i++) {
+    c = p_clauses + i;
+    if (!c->uses) continue;
+    res = c->p2 ? reconstruct (i) : i;
+    if (res == i && !c->size) break;
+    subst [i] = res;
+    if (lowered [i]) num_lowered++;
+  }
+
+  if (i <= root) {
+    p_empty_clause = i;
+    num_p_clauses = i + 1;
+  } else {
+    res = subst [root];
+    num_p_clauses = root + 1;
+    for (u = root - 1; u > 0; u--) {
+      if (!lowered [u]) continue;
+      lit = lowered [u];
+      if (!contains (p_clauses + res, -lit)) continue;
+      if (contains (p_clauses + subst [u], lit))
+        res = add_resolvent (res, subst [u], -lit);
+      else res = subst [u];
+    }
+    p_empty_clause = res;
+  }
+  assert (!p_clauses [p_empty_clause].size);
+
+  free (subst);
+  free (lowered);
+  subst = lowered = NULL;
+
+  after = trim_proof ();
+  fprintf (stderr, "proof compression: %d of %d clauses removed "
+           "(%d units recycled, %d units lowered)\n",
+           before - after, before, recycled, num_lowered);
+  return before - after;
+}
+
+void compress_state (Visit visit) {
+  VISIT (subst);
+  VISIT (lowered);
+}
@@ -0,0 +1,12 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "formula.h"
+#include "admin.h"
+#include "proof.h"
+
+
+int compress_proof ();
+void compress_state (Visit);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,6 +11,10 @@
 
 #include "extract.h"
 #include "simpleaig.h"
+#include "uset.h"
+#include "checkpoint.h"
+#include "profile.h"
+#include "stats.h"
 
 
 #define DEBUG  0
@@ -18,23 +23,20 @@
 #define aiger_false SIMPLEAIG_FALSE 
 #define aiger_true SIMPLEAIG_TRUE
 
-static int int_cmpfunc (const void * a, const void * b) {
-   return ( *(int*)a - *(int*)b );
-}
-
-static  int aig_aux;
-static simpleaig * aig;
-static simpleaig * aig_out;
-int print_aig_and = 1;
-int visited = 1;
-
-static int * var_order;
-int * tmp_var_array;
-char * aig_var_mapped;
-int * lit_to_lit;
-int * var_to_idx;
-int * idx_queue;
-int idx_queue_size, idx_queue_pos;
+static TLS int aig_aux;
+static TLS simpleaig * aig;
+static TLS simpleaig * aig_out;
+TLS int print_aig_and = 1;
+TLS int visited = 1;
+
+static TLS int * var_order;
+TLS int * tmp_var_array;
+TLS char * aig_var_mapped;
+TLS int * lit_to_lit;
+TLS int * var_to_idx;
+TLS int * idx_queue;
+TLS int * idx_owner;
+TLS int idx_queue_size;
 
 int og_cmpfunc (const void * a, const void * b) {
   const int *l1 = a, *l2 = b;
@@ -66,6 +68,12 @@ int plit2qlit (int l) {
   if(a == simpleaig_not(b))
     return aiger_false;
 
+  if (profile) {
+    unsigned num_ands = aig->num_ands;
+    int res = simpleaig_add_and (aig, aiger_false, a, b);
+    profile_gate (aig->num_ands > num_ands);
+    return res;
+  }
   return simpleaig_add_and (aig, aiger_false, a, b);
 
 }
@@ -109,9 +117,13 @@ void init_inputs_outputs () {
 
 }
 
+void use_aig (simpleaig *a) {
+  aig = a;
+}
+
 void init_output_aig () {
   aig_out = simpleaig_init ();
-  simpleaig_set_buckets (aig_out, aig->num_ands) ; 
+  simpleaig_set_buckets (aig_out, aig->num_ands ? aig->num_ands : 1) ; 
   
   aig_aux = num_vars ; 
   aig_out->lhs_aux = num_vars + 1; 
@@ -137,7 +149,7 @@ void init_aig_traversal() {
   lit_to_lit = (int *) malloc (sizeof (int) * (aig->max_var + 1));
   var_to_idx = (int *) malloc (sizeof (int) * (aig->max_var + 1));
   idx_queue = (int *) malloc (sizeof (int) * (aig->num_ands));
-  idx_queue_pos = 0;
+  idx_owner = (int *) malloc (sizeof (int) * (aig->num_ands));
   idx_queue_size = 0;
 
   for (int i = 0; i < aig->max_var + 1; i++) {
@@ -161,37 +173,59 @@ void release_aig_traversal() {
   free(lit_to_lit);
   free(var_to_idx);
   free(idx_queue);
+  free(idx_owner);
 }
 
 char aig_is_const (int v) {
   return v == aiger_true || v == aiger_false;
 }
 
-void aig_get_cone (int v) {
-  assert(!aig_var_mapped[v]);
-  aig_var_mapped[v] = 1;
-  assert(var_to_idx[v] < aig->num_ands);
-  idx_queue[0] = var_to_idx[v];
-  idx_queue_size = 1;
-  idx_queue_pos = 0;
-  while (idx_queue_pos < idx_queue_size) {
-    int idx = idx_queue[idx_queue_pos++];
-    simpleaigand *and = aig->ands + idx;
-    if (!aig_is_const(and->rhs0) && aig_var_mapped[abs(and->rhs0)] == 0) {
-      aig_var_mapped[abs(and->rhs0)] = 1;
-      assert(var_to_idx[abs(and->rhs0)] < aig->num_ands);
-      idx_queue[idx_queue_size++] = var_to_idx[abs(and->rhs0)];
+/* The cones of all universal outputs are copied into aig_out in one pass.
+ * Each gate belongs to the first output, in prefix order, whose cone
+ * contains it. Labels of a universal only refer to universals preceding it,
+ * and gates are created before the gates using them, except for the output
+ * gates at the end. Hence the owners can be found in one walk over the gates
+ * in reverse index order, and copying the gates of each output in index
+ * order, outputs in prefix order, respects all dependencies. */
+
+void aig_get_cones () {
+  int num_outputs = 0;
+  Scope *s;
+  Var *v;
+
+  for (int i = 0; i < aig->num_ands; i++) idx_owner[i] = INT_MAX;
+  for (s = outer_most; s; s = s->inner) {
+    if (s->type != FORALL) continue;
+    for (v = s->first; v; v = v->next) {
+      assert(var_to_idx[v->name] < aig->num_ands);
+      idx_owner[var_to_idx[v->name]] = num_outputs++;
     }
-    if (!aig_is_const(and->rhs1) && aig_var_mapped[abs(and->rhs1)] == 0) {
-      aig_var_mapped[abs(and->rhs1)] = 1;
-      assert(var_to_idx[abs(and->rhs1)] < aig->num_ands);
-      idx_queue[idx_queue_size++] = var_to_idx[abs(and->rhs1)];
+  }
+
+  for (int i = aig->num_ands - 1; i >= 0; i--) {
+    simpleaigand *and = aig->ands + i;
+    if (idx_owner[i] == INT_MAX) continue;
+    int rhs[2] = { and->rhs0, and->rhs1 };
+    for (int j = 0; j < 2; j++) {
+      if (aig_is_const(rhs[j]) || aig_var_mapped[abs(rhs[j])]) continue;
+      int idx = var_to_idx[abs(rhs[j])];
+      assert(idx < aig->num_ands);
+      if (idx_owner[idx] > idx_owner[i]) idx_owner[idx] = idx_owner[i];
     }
   }
-  qsort(idx_queue, idx_queue_size, sizeof(int), int_cmpfunc);
+
+  // Bucket the gates by owner, keeping index order within each output
+  int *start = (int *) calloc (num_outputs + 1, sizeof (int));
+  for (int i = 0; i < aig->num_ands; i++)
+    if (idx_owner[i] != INT_MAX) start[idx_owner[i] + 1]++;
+  for (int i = 0; i < num_outputs; i++) start[i + 1] += start[i];
+  idx_queue_size = start[num_outputs];
+  for (int i = 0; i < aig->num_ands; i++)
+    if (idx_owner[i] != INT_MAX) idx_queue[start[idx_owner[i]]++] = i;
+  free(start);
 }
 
-void aig_map_cone (int v) {
+void aig_map_cones () {
   for (int i = 0; i < idx_queue_size; i++) {
     int idx = idx_queue[i];
     simpleaigand *and = aig->ands + idx;
@@ -210,19 +244,19 @@ void aig_map_cone (int v) {
       int rhs1_mapped = lit_to_lit[abs(and->rhs1)];
       rhs1 = and->rhs1 > 0 ? rhs1_mapped : simpleaig_not(rhs1_mapped);
     }
-    if (and->lhs == v) {
-      lit_to_lit[and->lhs] = simpleaig_add_and(aig_out, v, rhs0, rhs1);
+    // Gates of universal outputs keep their variable
+    if (and->lhs <= num_vars) {
+      lit_to_lit[and->lhs] = simpleaig_add_and(aig_out, and->lhs, rhs0, rhs1);
     } else {
       lit_to_lit[and->lhs] = simpleaig_add_and(aig_out, SIMPLEAIG_FALSE, rhs0, rhs1);
     }
-    assert(aig_var_mapped[and->lhs]);
+    aig_var_mapped[and->lhs] = 1;
   }
 }
 
 
 void init_outermost_univ () {
   //TODO assumption: only one empty clause,
-  //no clauses that are not connected to the empty clause
   //all declared vars occur in proof
   //
 
@@ -242,6 +276,77 @@ void init_outermost_univ () {
 
 }
 
+// The universals of a clause point into its interned set
+static void set_uset (P_Clause *cl, int id) {
+  cl->uset = id;
+  cl->universals = usets[id].vars;
+  cl->num_universals = usets[id].size;
+}
+
+/* Leaves instantiating clauses under the same assignment of universals get
+ * identical labels, since these only depend on the universal literals of the
+ * leaf. The labels are computed once per set of literals and shared by the
+ * leaves, which hold a reference each. */
+
+typedef struct LeafLabel {
+  int size;          // number of universal literals
+  int *key;          // universal literals, sorted by the prefix
+  int uset;
+  int *aig_labels;
+  int refs;          // leaves sharing the labels, freed at 0
+  int next;          // next entry in the same bucket
+} LeafLabel;
+
+static TLS LeafLabel *leaf_labels;
+static TLS int num_leaf_labels, size_leaf_labels;
+static TLS int *leaf_buckets;
+static TLS unsigned leaf_buckets_size;
+
+static void init_leaf_cache (unsigned size) {
+  leaf_buckets_size = 1;
+  while (leaf_buckets_size < size) leaf_buckets_size <<= 1;
+  NEWN (leaf_buckets, leaf_buckets_size);
+  num_leaf_labels = 1;
+}
+
+static void release_leaf_cache () {
+  for (int i = 1; i < num_leaf_labels; i++) {
+    free (leaf_labels [i].key);
+    free (leaf_labels [i].aig_labels);
+  }
+  free (leaf_labels);
+  free (leaf_buckets);
+  leaf_labels = NULL;
+  leaf_buckets = NULL;
+  num_leaf_labels = size_leaf_labels = 0;
+}
+
+// Returns the entry for the literals in 'lits', creating it if needed
+static int find_leaf_label () {
+  unsigned h = 0;
+  int i, e;
+
+  for (i = 0; i < num_lits; i++) h = (h * 17) ^ lits[i];
+  h &= leaf_buckets_size - 1;
+  for (e = leaf_buckets [h]; e; e = leaf_labels [e].next) {
+    if (leaf_labels [e].size != num_lits) continue;
+    for (i = 0; i < num_lits && leaf_labels [e].key[i] == lits[i]; i++);
+    if (i == num_lits) return e;
+  }
+  if (num_leaf_labels >= size_leaf_labels) {
+    int new_size = size_leaf_labels ? 2 * size_leaf_labels : 1024;
+    RSZ (leaf_labels, size_leaf_labels, new_size);
+    size_leaf_labels = new_size;
+  }
+  e = num_leaf_labels++;
+  leaf_labels [e].size = num_lits;
+  leaf_labels [e].key = (int *) malloc (sizeof (int) * num_lits);
+  for (i = 0; i < num_lits; i++) leaf_labels [e].key[i] = lits[i];
+  leaf_labels [e].next = leaf_buckets [h];
+  leaf_buckets [h] = e;
+  return e;
+}
+
 void extract_leaf (P_Clause *cl) {
   assert(cl->p2 == 0);
   // First, compute universal literals in original clause and annotations
@@ -260,7 +365,7 @@ void extract_leaf (P_Clause *cl) {
     }
   }
 
-  Clause* og_clause =  &clauses [cl->p1];
+  Clause* og_clause =  &clauses [cl->p1 - 1];
   for (int i = 0; i < og_clause->size; i++) {
     int lit = og_clause->lits[i];
     if (is_universal(lit) && tmp_var_array [abs(lit)] < cl->name) {
@@ -268,40 +373,64 @@ void extract_leaf (P_Clause *cl) {
         push_literal(lit);
     }
   }
-  // Copy complete annotation
-  cl->universals = (int *) malloc (sizeof (int) * num_lits);
-  for (int i = 0; i < num_lits; i++) {
-    cl->universals[i] = lits[i];
+  if (num_lits) qsort(lits, num_lits, sizeof(int), og_cmpfunc);
+
+  int e = find_leaf_label ();
+  LeafLabel *label = leaf_labels + e;
+  cl->leaf_label = e;
+  if (label->refs++) {
+    set_uset(cl, label->uset);
+    cl->aig_labels = label->aig_labels;
+    return;
   }
-  qsort(cl->universals, num_lits, sizeof(int), og_cmpfunc);
-  // Second, compute AIG labels for partial functions
+
+  // Second, compute AIG labels for partial functions. Only universals with
+  // a label other than true are stored, missing labels are true.
   cl->aig_labels = (int *) malloc (sizeof (int) * num_lits);
+  int n = 0;
   // This circuit checks whether the universals so far match the annotation
   int annotation_match_aig = aiger_true;
 
   for (int i = 0; i < num_lits; i++) {
-    if (cl->universals[i] > 0) {
-      cl->aig_labels[i] = aiger_true;
-      annotation_match_aig = makeAND(annotation_match_aig, cl->universals[i]);
+    int aig_label;
+    if (lits[i] > 0) {
+      aig_label = aiger_true;
+      annotation_match_aig = makeAND(annotation_match_aig, lits[i]);
     } else {
-      cl->aig_labels[i] = makeITE(annotation_match_aig, aiger_false, aiger_true);
-      annotation_match_aig = makeAND(annotation_match_aig, simpleaig_not(abs(cl->universals[i])));
+      aig_label = makeITE(annotation_match_aig, aiger_false, aiger_true);
+      annotation_match_aig = makeAND(annotation_match_aig, simpleaig_not(abs(lits[i])));
     }
+    if (aig_label == aiger_true) continue;
     // Forget the sign of the annotation literal
     // We only need to know which universal variables have partial functions
-    cl->universals[i] = abs(cl->universals[i]);
+    lits[n] = abs(lits[i]);
+    cl->aig_labels[n++] = aig_label;
   }
-  cl->num_universals = num_lits;
+  label->uset = uset_intern(lits, n);
+  label->aig_labels = cl->aig_labels;
+  set_uset(cl, label->uset);
 }
 
 
-void extract_non_leaf (P_Clause *cl) {
-  P_Clause *p1, *p2; 
-  int pivot = cl->pivot;
+// Stores the labels of a resolvent, whose universals are those pushed on
+// 'lits', a subset of the set 'all'
+static void set_labels (P_Clause *cl, int all, int *aig_labels, int nr_labels) {
+  if (num_lits == usets[all].size) {
+    set_uset(cl, all);
+  } else {
+    set_uset(cl, uset_intern(lits, num_lits));
+    uset_release(all);
+  }
+  cl->aig_labels = (int *) malloc (sizeof (int) * nr_labels);
+  for (int i = 0; i < nr_labels; i++) {
+    cl->aig_labels[i] = aig_labels[i];
+  }
+  free(aig_labels);
+}
+
+static void resolve (P_Clause *cl, P_Clause *p1, P_Clause *p2, int pivot) {
   int pivot_og_var = a_lit2var(pivot);
   
-  p1 = p_clauses + cl->p1; 
-  p2 = p_clauses + cl->p2;
   dprint ("  parents: %d %d, pivot: %d\n", p1->name, p2->name, pivot); 
 
   assert (p1 && p2);
@@ -312,7 +441,8 @@ void extract_non_leaf (P_Clause *cl) {
   int* aig_labels1 = p1->aig_labels;
   int* aig_labels2 = p2->aig_labels;
 
-  int* aig_labels = (int *) malloc (sizeof (int) * (p1->num_universals + p2->num_universals));
+  int all = uset_union(p1->uset, p2->uset);
+  int* aig_labels = (int *) malloc (sizeof (int) * usets[all].size);
   int nr_labels = 0;
 
   // Get pivot annotation
@@ -381,17 +511,131 @@ void extract_non_leaf (P_Clause *cl) {
       // Pivot is existential and u is universal
       assert(0);
     }
+    // Missing labels are true, so only other labels are kept
+    if (aig_labels[nr_labels - 1] == aiger_true) {
+      nr_labels--;
+      num_lits--;
+    }
   }
-  cl->universals = (int *) malloc (sizeof (int) * num_lits);
-  for (int i = 0; i < num_lits; i++) {
-    cl->universals[i] = lits[i];
+  set_labels(cl, all, aig_labels, nr_labels);
+}
+
+/* Specialised versions of resolve for prefixes in which no universal is
+ * followed by an existential (exists-forall) or no existential by a
+ * universal (forall-exists), as in 2QBF. */
+
+// Every universal comes after the pivot, whose annotation is empty
+static void resolve_exists_forall (P_Clause *cl, P_Clause *p1, P_Clause *p2, int pivot) {
+  int pivot_og_var = a_lit2var(pivot);
+  int pivot_aig = pivot > 0 ? pivot_og_var : simpleaig_not(pivot_og_var);
+  int all = uset_union(p1->uset, p2->uset);
+  int* aig_labels = (int *) malloc (sizeof (int) * usets[all].size);
+  int nr_labels = 0;
+
+  int i, j;
+  num_lits = 0; // Reused from parser
+  for (i = j = 0; i < p1->num_universals || j < p2->num_universals; ) {
+    int u, aig1 = aiger_true, aig2 = aiger_true;
+    if (j == p2->num_universals ||
+        (i < p1->num_universals && var_order[p1->universals[i]] <= var_order[p2->universals[j]])) {
+      u = p1->universals[i];
+      aig1 = p1->aig_labels[i++];
+      if (j < p2->num_universals && p2->universals[j] == u) aig2 = p2->aig_labels[j++];
+    } else {
+      u = p2->universals[j];
+      aig2 = p2->aig_labels[j++];
+    }
+    // Shared
+    int aig_label = makeITE(pivot_aig, aig2, aig1);
+    if (aig_label == aiger_true) continue;
+    push_literal(u);
+    aig_labels[nr_labels++] = aig_label;
   }
-  cl->num_universals = num_lits;
-  cl->aig_labels = (int *) malloc (sizeof (int) * nr_labels);
-  for (int i = 0; i < nr_labels; i++) {
-    cl->aig_labels[i] = aig_labels[i];
+  set_labels(cl, all, aig_labels, nr_labels);
+}
+
+// Every universal precedes the pivot and occurs in its annotation
+static void resolve_forall_exists (P_Clause *cl, P_Clause *p1, P_Clause *p2, int pivot) {
+  A_Var *av = a_vars + abs(pivot);
+  int all = uset_union(p1->uset, p2->uset);
+  int* aig_labels = (int *) malloc (sizeof (int) * usets[all].size);
+  int nr_labels = 0;
+
+  qsort(av->u_annotations, av->ann_size, sizeof(int), og_cmpfunc);
+
+  int annotation_match_aig = aiger_true;
+
+  int i, j, k;
+  num_lits = 0; // Reused from parser
+  for (i = j = k = 0; i < p1->num_universals || j < p2->num_universals; ) {
+    int u, aig1 = aiger_true, aig2 = aiger_true;
+    if (j == p2->num_universals ||
+        (i < p1->num_universals && var_order[p1->universals[i]] <= var_order[p2->universals[j]])) {
+      u = p1->universals[i];
+      aig1 = p1->aig_labels[i++];
+      if (j < p2->num_universals && p2->universals[j] == u) aig2 = p2->aig_labels[j++];
+    } else {
+      u = p2->universals[j];
+      aig2 = p2->aig_labels[j++];
+    }
+    // Update annotation match AIG with literals preceding u
+    for (; k < av->ann_size && abs(av->u_annotations[k]) != u; k++) {
+      int annotation_lit = av->u_annotations[k];
+      annotation_match_aig = makeAND(annotation_match_aig, annotation_lit > 0 ? annotation_lit : simpleaig_not(abs(annotation_lit)));
+    }
+    assert(k < av->ann_size);
+    int aig_label;
+    if (av->u_annotations[k] > 0) {
+      // Definitely in 1 part
+      aig_label = makeAND(aig1, aig2);
+    } else {
+      // Possibly in 0 part
+      aig_label = makeITE(annotation_match_aig, makeOR(aig1, aig2), makeAND(aig1, aig2));
+    }
+    if (aig_label == aiger_true) continue;
+    push_literal(u);
+    aig_labels[nr_labels++] = aig_label;
+  }
+  set_labels(cl, all, aig_labels, nr_labels);
+}
+
+static TLS void (*resolve_step) (P_Clause *, P_Clause *, P_Clause *, int) = resolve;
+
+// Picks the version of resolve for the shape of the prefix
+static void init_resolve_step () {
+  int forall_before_exists = 0, exists_before_forall = 0;
+  Scope *s;
+
+  for (s = outer_most; s && s->inner; s = s->inner) {
+    if (s->type == FORALL && s->inner->type == EXISTS) forall_before_exists = 1;
+    if (s->type == EXISTS && s->inner->type == FORALL) exists_before_forall = 1;
+  }
+  if (!forall_before_exists) resolve_step = resolve_exists_forall;
+  else if (!exists_before_forall) resolve_step = resolve_forall_exists;
+  else resolve_step = resolve;
+}
+
+void extract_non_leaf (P_Clause *cl) {
+  if (profile) profile_pivot (cl->pivot);
+  resolve_step (cl, p_clauses + cl->p1, p_clauses + cl->p2, cl->pivot);
+}
+
+// Fold a resolution chain from left to right, keeping only the labels of
+// the last intermediate resolvent
+void extract_chain (P_Clause *cl) {
+  P_Clause tmp[2], *first = p_clauses + cl->chain[0], *left = first;
+  memset(tmp, 0, sizeof tmp);
+  tmp[0].name = tmp[1].name = cl->name;
+  for (int i = 1; i < cl->chain_size; i++) {
+    P_Clause *res = i == cl->chain_size - 1 ? cl : tmp + (i & 1);
+    if (profile) profile_pivot (cl->pivots[i - 1]);
+    resolve_step(res, left, p_clauses + cl->chain[i], cl->pivots[i - 1]);
+    if (left != first) {
+      uset_release(left->uset);
+      free(left->aig_labels);
+    }
+    left = res;
   }
-  free(aig_labels);
 }
 
 /* void extract_univ (Scope *s, int level) {
@@ -453,6 +697,25 @@ void extract_non_leaf (P_Clause *cl) {
   }
 } */
 
+// Labels of a parent are no longer needed once all its children are done
+static void release_labels (int i) {
+  P_Clause *p = p_clauses + i;
+  if (--p->uses) return;
+  if (p->leaf_label) {
+    LeafLabel *label = leaf_labels + p->leaf_label;
+    if (!--label->refs) {
+      uset_release(label->uset);
+      free(label->aig_labels);
+      label->aig_labels = NULL;
+    }
+    p->leaf_label = 0;
+  } else {
+    uset_release(p->uset);
+    free(p->aig_labels);
+  }
+  p->universals = p->aig_labels = NULL;
+}
+
 void create_var_order() {
   var_order = (int *) malloc (sizeof (int) * (num_vars + 1));
   
@@ -473,29 +736,62 @@ simpleaig * extract () {
   dprint ("extract: first fresh aiger var: %d\n", aig_aux);
 
   create_var_order();
+  init_resolve_step();
+  int live = trim_proof ();
 
   aig = simpleaig_init ();
-  simpleaig_set_buckets (aig, (unsigned) universal_vars * p_clauses_size * 2) ; 
+  simpleaig_set_buckets (aig, universal_vars && live ? (unsigned) universal_vars * live * 2 : 1) ; 
   init_inputs_outputs ();
   
   aig_aux = num_vars ; 
   aig->lhs_aux = num_vars + 1; 
 
   tmp_var_array = (int *) malloc (sizeof (int) * (num_vars + 1));
+  init_leaf_cache (live);
+  uset_init (var_order, live);
 
   for (int i = 0; i < num_vars + 1; i++) {
     tmp_var_array [i] = 0; 
   }
 
+  int first = resume ? checkpoint_load (aig) + 1 : 0;
+
+  counters [COUNT_PROOF_CLAUSES] = num_p_clauses;
+  counters [COUNT_LIVE_CLAUSES] = live;
+  stats_begin (PHASE_EXTRACT);
+  if (profile) profile_init ();
+  if (progress) progress_begin (first);
+
   // Compute partial interpolants
 
-  for (int i = 0; i < num_p_clauses; i++) {
+  for (int i = first; i < num_p_clauses; i++) {
+    if (checkpoint_file && i > first && !(i & 1023) && checkpoint_due ())
+      checkpoint_save (aig, i - 1);
+    if (progress && !(i & 1023) && progress_due ())
+      progress_report (i, num_p_clauses, aig->num_ands,
+                       (double) aig->num_ands / aig->buckets_size);
+    if (!p_clauses [i].uses) continue;
+    if (profile) profile_clause (i);
     if (!p_clauses [i].p2) {
       extract_leaf (p_clauses + i);
+      counters [COUNT_LEAVES]++;
+    } else if (p_clauses [i].chain) {
+      extract_chain (p_clauses + i);
+      counters [COUNT_RESOLUTIONS] += p_clauses [i].chain_size - 1;
+      for (int j = 0; j < p_clauses [i].chain_size; j++)
+        release_labels (p_clauses [i].chain[j]);
     } else {
       extract_non_leaf (p_clauses + i);
+      counters [COUNT_RESOLUTIONS]++;
+      release_labels (p_clauses [i].p1);
+      release_labels (p_clauses [i].p2);
     }
   }
+  stats_end (PHASE_EXTRACT);
+  if (profile) {
+    profile_report (stdout);
+    profile_release ();
+  }
 
   // Set universal strategy function to constant true by default
 
@@ -526,29 +822,23 @@ simpleaig * extract () {
     s = s->inner;
   }
 
+  counters [COUNT_GATES_CREATED] = aig->num_ands_total;
+  counters [COUNT_GATES_SHARED] = aig->num_ands_shared;
+
+  stats_begin (PHASE_CONES);
   init_output_aig();
   init_aig_traversal();
 
-  s = outer_most;
-
-  while (s) {
-  if (s->type == EXISTS) {
-    s = s->inner;
-    continue;
-  }
-  assert(s->type == FORALL);
-  Var *v = s->first;
-  while (v) {
-    aig_get_cone(v->name);
-    aig_map_cone(v->name);
-    v = v->next;
-  }
-  s = s->inner;
-}
+  aig_get_cones();
+  aig_map_cones();
+  stats_end (PHASE_CONES);
 
   ////aiger_prune (aig); 
 
   release_aig_traversal();
+  release_labels(p_empty_clause);
+  release_leaf_cache();
+  uset_reset();
 
   free(tmp_var_array);
   free(var_order);
@@ -558,4 +848,24 @@ simpleaig * extract () {
   return aig_out; 
 }
 
-
+void extract_state (Visit visit) {
+  VISIT (aig_aux);
+  VISIT (aig);
+  VISIT (aig_out);
+  VISIT (print_aig_and);
+  VISIT (visited);
+  VISIT (var_order);
+  VISIT (tmp_var_array);
+  VISIT (aig_var_mapped);
+  VISIT (lit_to_lit);
+  VISIT (var_to_idx);
+  VISIT (idx_queue);
+  VISIT (idx_owner);
+  VISIT (idx_queue_size);
+  VISIT (leaf_labels);
+  VISIT (num_leaf_labels);
+  VISIT (size_leaf_labels);
+  VISIT (leaf_buckets);
+  VISIT (leaf_buckets_size);
+  VISIT (resolve_step);
+}
@@ -8,5 +8,10 @@
 
 
 simpleaig * extract (); 
+void extract_state (Visit);
+
+// Gate construction on 'a' outside extract (microbench.c)
+void use_aig (simpleaig *a);
+int makeITE (int, int, int);
 
 #endif
@@ -7,35 +7,187 @@
 #include "formula.h"
 #include "admin.h"
 #include "proof.h"
+#include "checkpoint.h"
+#include "compress.h"
 #include "extract.h"
+#include "minimize.h"
+#include "profile.h"
+#include "serve.h"
 #include "simpleaig.h"
+#include "stats.h"
+
+static const char * usage =
+"usage: ferpcert [ <option> ... ] <qbf> <proof> <aig>\n"
+"       ferpcert --serve=<socket> [ --workers=<n> ]\n"
+"\n"
+"  <proof> is a FERP trace, or a tracecheck trace if --cnf is given\n"
+"\n"
+"  -h, --help         print this message and exit\n"
+"  --check            check the proof while parsing it (replaces ferpcheck)\n"
+"  --compress         compress the proof (RecycleUnits, LowerUnits) before\n"
+"                     extraction\n"
+"  --minimize=<sec>   minimise the strategy on its care set for at most\n"
+"                     <sec> seconds; care sets are exact up to 16\n"
+"                     existentials and sampled beyond, so check the result\n"
+"  --unminimized=<file>\n"
+"                     also write the strategy before --minimize to <file>\n"
+"  --checkpoint=<file>\n"
+"                     save the state of the extraction to <file> regularly\n"
+"  --checkpoint-interval=<sec>\n"
+"                     seconds between checkpoints (default 600)\n"
+"  --resume           continue from the checkpoint given by --checkpoint\n"
+"  --stats=json[:<file>]\n"
+"                     print time, memory and counters per phase as JSON, to\n"
+"                     <file> instead of stdout if given\n"
+"  --profile=<n>      attribute the gates of the extraction to proof clauses\n"
+"                     and pivot variables and print the <n> largest of each\n"
+"  --progress=<sec>   report the progress of the extraction on stderr at most\n"
+"                     every <sec> seconds\n"
+"  --progress-file=<file>\n"
+"                     write the latest progress line to <file> instead\n"
+"  --cnf=<file>       expanded CNF with expansion comments (ijtihad --log_phi);\n"
+"                     <proof> is then a resolution trace, either binary\n"
+"                     (tracecheck -B) or with chains (picosat -T)\n"
+"  --lrat             <proof> is an LRAT proof of the CNF given by --cnf\n"
+"                     (cadical --lrat --no-binary)\n"
+"  --serve=<socket>   run jobs sent to the UNIX socket <socket> until SIGINT\n"
+"                     or SIGTERM; a job is a line '[ --compress ]\n"
+"                     [ --minimize=<sec> ] [ --binary ] [ --qbf-size=<n> ]\n"
+"                     [ --proof-size=<n> ] <qbf> <proof> <aig>', where '-'\n"
+"                     reads <qbf> or <proof> as <n> bytes from the socket\n"
+"                     and returns <aig> in the result, one line of JSON\n"
+"                     per job; proofs are always checked\n"
+"  --workers=<n>      number of threads running jobs (default: cores)\n";
 
 
 int main (int argc, char **argv) {
   FILE *in_proof = stdin; 		// FERP proof
   FILE *in_qbf = stdin; 		// original QBF
   FILE *out_aig = stdin;		// aiger file
+  FILE *in_cnf = NULL;		// expanded CNF
   simpleaig * aig = NULL; 
   char binary = 0; 
+  char *files [3], *cnf = NULL, *serve_socket = NULL, *stats_file = NULL;
+  char *unminimized = NULL;
+  int i, num_files = 0, lrat = 0, compress = 0, workers = 0;
+  double minimize = -1;
 
-  if (argc != 4) die ("invalid number of arguments"); 
+  for (i = 1; i < argc; i++) {
+    if (!strcmp (argv [i], "-h") || !strcmp (argv [i], "--help")) {
+      fputs (usage, stdout);
+      return 0;
+    } else if (!strncmp (argv [i], "--cnf=", 6)) {
+      cnf = argv [i] + 6;
+    } else if (!strcmp (argv [i], "--lrat")) {
+      lrat = 1;
+    } else if (!strcmp (argv [i], "--check")) {
+      check_proof = 1;
+    } else if (!strcmp (argv [i], "--compress")) {
+      compress = 1;
+    } else if (!strncmp (argv [i], "--minimize=", 11)) {
+      minimize = atof (argv [i] + 11);
+      if (minimize < 0) die ("invalid time limit '%s'", argv [i] + 11);
+    } else if (!strncmp (argv [i], "--unminimized=", 14)) {
+      unminimized = argv [i] + 14;
+    } else if (!strncmp (argv [i], "--checkpoint=", 13)) {
+      checkpoint_file = argv [i] + 13;
+    } else if (!strncmp (argv [i], "--checkpoint-interval=", 22)) {
+      checkpoint_interval = atoi (argv [i] + 22);
+      if (checkpoint_interval < 0) die ("invalid interval '%s'", argv [i] + 22);
+    } else if (!strcmp (argv [i], "--resume")) {
+      resume = 1;
+    } else if (!strncmp (argv [i], "--stats=", 8)) {
+      if (!strncmp (argv [i] + 8, "json:", 5) && argv [i][13]) stats_file = argv [i] + 13;
+      else if (strcmp (argv [i] + 8, "json")) die ("invalid stats format '%s'", argv [i] + 8);
+      stats = 1;
+    } else if (!strncmp (argv [i], "--profile=", 10)) {
+      profile = atoi (argv [i] + 10);
+      if (profile <= 0) die ("invalid number '%s'", argv [i] + 10);
+    } else if (!strncmp (argv [i], "--progress=", 11)) {
+      progress = atof (argv [i] + 11);
+      if (progress <= 0) die ("invalid interval '%s'", argv [i] + 11);
+    } else if (!strncmp (argv [i], "--progress-file=", 16)) {
+      progress_file = argv [i] + 16;
+    } else if (!strncmp (argv [i], "--serve=", 8)) {
+      serve_socket = argv [i] + 8;
+    } else if (!strncmp (argv [i], "--workers=", 10)) {
+      workers = atoi (argv [i] + 10);
+      if (workers <= 0) die ("invalid number '%s'", argv [i] + 10);
+    } else if (argv [i][0] == '-' && argv [i][1]) {
+      die ("invalid option '%s' (try '-h')", argv [i]);
+    } else if (num_files < 3) {
+      files [num_files++] = argv [i];
+    } else die ("invalid number of arguments");
+  }
+  if (serve_socket) {
+    if (num_files || argc != 2 + (workers > 0)) die ("--serve takes no options but --workers");
+    return serve (serve_socket, workers);
+  }
+  if (workers) die ("--workers requires --serve");
+  if (num_files != 3) die ("invalid number of arguments"); 
+  if (lrat && !cnf) die ("--lrat requires --cnf");
+  if (resume && !checkpoint_file) die ("--resume requires --checkpoint");
+  if (progress_file && !progress) die ("--progress-file requires --progress");
+  if (unminimized && minimize < 0) die ("--unminimized requires --minimize");
   
-  in_qbf = fopen (argv [1], "r"); 
-  in_proof = fopen (argv [2], "r"); 
-  out_aig = fopen (argv [3], "w"); 
+  in_qbf = fopen (files [0], "r"); 
+  in_proof = fopen (files [1], "r"); 
+  out_aig = fopen (files [2], "w"); 
+  if (cnf) in_cnf = fopen (cnf, "r");
 
-  if (!in_qbf) die ("could not open QBF %s", argv [1]); 
-  if (!in_proof) die ("could not open proof %s", argv [2]); 
+  if (!in_qbf) die ("could not open QBF %s", files [0]); 
+  if (!in_proof) die ("could not open proof %s", files [1]); 
+  if (cnf && !in_cnf) die ("could not open CNF %s", cnf);
 
+  stats_begin (PHASE_PARSE_QBF);
   if (parse_qbf (in_qbf)) {
-    die ("could not parse QBF %s", argv [1]); 
+    die ("could not parse QBF %s", files [0]); 
+  }
+  stats_end (PHASE_PARSE_QBF);
+  stats_begin (PHASE_PARSE_PROOF);
+  if (in_cnf) {
+    if (parse_expansion (in_cnf, lrat)) die ("could not parse CNF %s", cnf);
+    if (lrat) {
+      if (parse_lrat (in_proof)) die ("could not parse LRAT proof %s", files [1]);
+    } else if (parse_trace (in_proof)) {
+      die ("could not parse trace %s", files [1]);
+    }
+    fclose (in_cnf);
+  } else if (parse_proof (in_proof)) {
+    die ("could not parse proof %s", files [1]); 
   }
-  if (parse_proof (in_proof)) {
-    die ("could not parse proof %s", argv [2]); 
+  stats_end (PHASE_PARSE_PROOF);
+  if (compress) {
+    stats_begin (PHASE_COMPRESS);
+    compress_proof ();
+    stats_end (PHASE_COMPRESS);
   }
   aig = extract(); 
+  if (unminimized) {
+    FILE *out = fopen (unminimized, "w");
+    if (!out) die ("could not write strategy %s", unminimized);
+    stats_begin (PHASE_WRITE);
+    simpleaig_write_aiger_to_file (aig, out, binary);
+    stats_end (PHASE_WRITE);
+    fclose (out);
+  }
+  if (minimize >= 0) {
+    stats_begin (PHASE_MINIMIZE);
+    aig = minimize_strategy (aig, minimize);
+    stats_end (PHASE_MINIMIZE);
+  }
 
+  stats_begin (PHASE_WRITE);
   simpleaig_write_aiger_to_file (aig, out_aig, binary);  
+  stats_end (PHASE_WRITE);
+  counters [COUNT_OUTPUT_GATES] = aig->num_ands;
+  if (stats) {
+    FILE *out = stats_file ? fopen (stats_file, "w") : stdout;
+    if (!out) die ("could not write statistics %s", stats_file);
+    stats_print_json (out);
+    if (stats_file && fclose (out)) die ("could not write statistics %s", stats_file);
+  }
+  if (checkpoint_file) checkpoint_remove ();
 //  printf ("%d\n", p_empty_clause); 
 //  print_proof(); 
   simpleaig_reset (aig); 
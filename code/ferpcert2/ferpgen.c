@@ -0,0 +1,390 @@
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Generator of false QBFs together with FERP traces refuting them, for
+ * benchmarking ferpcert at scale without running a solver.
+ *
+ * The prefix is E0 A1 E1 ... Ad Ed. The proof consists of levels 0 ... l of
+ * w derived units each, where level k uses existentials of block
+ * k * (d + 1) / (l + 1). The units of level 0 are leaves. A unit y of level
+ * k + 1 is derived by resolving a leaf
+ *
+ *   -y_1 v ... v -y_r v y
+ *
+ * with r units y_i of level k, so every unit is used r times. All
+ * variables of a leaf carry the same annotation, hence the units of a level
+ * form groups of equal annotation, and each group splits into a groups when
+ * a universal block is crossed. Leaves contain the universals of the blocks
+ * crossed last, falsified by their annotation. Finally, one leaf per group
+ * collects its units of level l together with a full clause over variables
+ * z of E0, and these clauses are resolved to the empty clause.
+ *
+ * The generator makes three passes with the same random choices: one to
+ * count variables and clauses, one for the expansion variables and one for
+ * the clauses. Memory use only depends on the width. */
+
+static const char * usage =
+"usage: ferpgen [ <option> ... ] <qbf> <proof>\n"
+"\n"
+"  -u <n>   number of universals (default 8)\n"
+"  -d <n>   number of universal blocks, i.e. prefix depth (default 2)\n"
+"  -a <n>   annotation width: annotations of the existentials of a block per\n"
+"           annotation of the previous block (default 2)\n"
+"  -l <n>   depth of the proof in levels of units (default 10)\n"
+"  -w <n>   width of the proof in units per level (default 16)\n"
+"  -r <n>   reuse factor, i.e. uses of each unit (default 2)\n"
+"  -s <n>   random seed (default 0)\n";
+
+typedef struct {
+  int size;      // units of the group
+  int parent;    // group of the previous level
+  char *tau;     // annotation, one value per universal
+} Group;
+
+enum { COUNT, VARS, CLAUSES };
+
+static int num_univ = 8, depth = 2, width_split = 2, levels = 10, width = 16,
+           reuse = 2;
+static unsigned long long seed;
+
+static int *univ_first;   // first universal of each block 1 ... d + 1
+static int *univ_var;     // variable of each universal
+static int *level_base;   // variable of the first existential of each level
+static int *level_size;   // existentials of each level
+static int z_base, num_z, num_vars;
+
+static long long num_orig, next_orig, next_proof, next_exp;
+static int mode;
+
+static Group *groups, *next_groups;
+static int num_groups, num_next_groups;
+static long long *units, *next_units;   // proof clause of each unit
+static long long *exp_vars, *next_exp_vars;
+static long long *goals;
+
+static FILE *qbf, *proof;
+static unsigned long long rng;
+
+static void die (const char *fmt, ...) {
+  va_list ap;
+  fputs ("*** ferpgen: ", stderr);
+  va_start (ap, fmt);
+  vfprintf (stderr, fmt, ap);
+  va_end (ap);
+  fputc ('\n', stderr);
+  exit (1);
+}
+
+static unsigned long long next_random () {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return rng;
+}
+
+static void *alloc (size_t bytes) {
+  void *res = calloc (1, bytes ? bytes : 1);
+  if (!res) die ("out of memory");
+  return res;
+}
+
+static int block_of_level (int k) {
+  return (long long) k * (depth + 1) / (levels + 1);
+}
+
+static int tau_lit (Group *g, int u) {
+  return g->tau [u] ? univ_var [u] : -univ_var [u];
+}
+
+// Declares the expansions of the existentials of a group of level k
+static void print_vars (Group *g, int k) {
+  int i, u;
+
+  fprintf (proof, "x");
+  for (i = 0; i < g->size; i++) fprintf (proof, " %lld", next_exp + i + 1);
+  fprintf (proof, " 0");
+  for (i = 0; i < g->size; i++) fprintf (proof, " %d", level_base [k] + i);
+  fprintf (proof, " 0");
+  for (u = 0; u < univ_first [block_of_level (k) + 1]; u++)
+    fprintf (proof, " %d", tau_lit (g, u));
+  fprintf (proof, " 0\n");
+}
+
+// Splits each group into groups with distinct values of the universals
+// [lo, hi[ for the next level
+static void split_groups (int lo, int hi) {
+  int i, j, t, n, split;
+  unsigned long long r, high;
+
+  num_next_groups = 0;
+  for (i = 0; i < num_groups; i++) {
+    Group *g = groups + i;
+    split = hi > lo ? width_split : 1;
+    if (hi - lo < 31 && split > 1 << (hi - lo)) split = 1 << (hi - lo);
+    if (split > g->size) split = g->size;
+    r = next_random ();
+    high = next_random ();
+    for (t = 0; t < split; t++) {
+      Group *h = next_groups + num_next_groups++;
+      n = g->size / split + (t < g->size % split);
+      h->size = n;
+      h->parent = i;
+      memcpy (h->tau, g->tau, num_univ);
+      for (j = 0; j < hi - lo; j++)
+        h->tau [lo + j] = j < 62 ? ((r + t) >> j) & 1 : (high >> (j & 63)) & 1;
+    }
+  }
+}
+
+static void swap_levels () {
+  Group *g = groups;
+  long long *l;
+
+  groups = next_groups;
+  next_groups = g;
+  num_groups = num_next_groups;
+  l = units; units = next_units; next_units = l;
+  l = exp_vars; exp_vars = next_exp_vars; next_exp_vars = l;
+}
+
+static void first_level () {
+  int i;
+
+  num_groups = 1;
+  groups [0].size = width;
+  if (mode == VARS) print_vars (groups, 0);
+  for (i = 0; i < width; i++) {
+    exp_vars [i] = ++next_exp;
+    units [i] = ++next_proof;
+    ++next_orig;
+    if (mode != CLAUSES) continue;
+    fprintf (qbf, "%d 0\n", level_base [0] + i);
+    fprintf (proof, "%lld %lld 0 %lld 0\n", units [i], exp_vars [i], next_orig);
+  }
+  if (mode == COUNT) level_size [0] = width;
+}
+
+static void next_level (int k) {
+  int i, j, m, u, f, c, g_first = 0, h_first = 0, max = 0;
+  int b = block_of_level (k), prev = block_of_level (k - 1);
+  int lo = univ_first [prev + 1], hi = univ_first [b + 1];
+  long long leaf, res, id;
+
+  split_groups (lo, hi);
+
+  // The children of a group are numbered c = 0, 1, ... over its new
+  // groups; child c uses the units c, ..., c + f - 1 of the group
+  for (i = 0, c = 0; i < num_next_groups; i++) {
+    Group *h = next_groups + i, *g = groups + h->parent;
+    if (i && h->parent != next_groups [i - 1].parent) {
+      g_first += g [-1].size;
+      c = 0;
+    }
+    f = reuse < g->size ? reuse : g->size;
+    if (h->size > max) max = h->size;
+    if (mode == VARS) print_vars (h, k);
+    for (j = 0; j < h->size; j++, c++) {
+      int unit = h_first + j;
+      next_exp_vars [unit] = ++next_exp;
+      leaf = ++next_proof;
+      ++next_orig;
+      if (mode == CLAUSES) {
+        for (m = 0; m < f; m++)
+          fprintf (qbf, "%d ", -(level_base [k - 1] + (c + m) % g->size));
+        fprintf (qbf, "%d ", level_base [k] + j);
+        for (u = lo; u < hi; u++) fprintf (qbf, "%d ", -tau_lit (h, u));
+        fprintf (qbf, "0\n");
+
+        fprintf (proof, "%lld", leaf);
+        for (m = 0; m < f; m++)
+          fprintf (proof, " %lld", -exp_vars [g_first + (c + m) % g->size]);
+        fprintf (proof, " %lld 0 %lld 0\n", next_exp_vars [unit], next_orig);
+      }
+      for (res = leaf, m = 0; m < f; m++, res = id) {
+        id = ++next_proof;
+        if (mode != CLAUSES) continue;
+        fprintf (proof, "%lld", id);
+        for (u = m + 1; u < f; u++)
+          fprintf (proof, " %lld", -exp_vars [g_first + (c + u) % g->size]);
+        fprintf (proof, " %lld 0 %lld %lld 0\n", next_exp_vars [unit], res,
+                 units [g_first + (c + m) % g->size]);
+      }
+      next_units [unit] = res;
+    }
+    h_first += h->size;
+  }
+  if (mode == COUNT) level_size [k] = max;
+  swap_levels ();
+}
+
+// Literal of the expansion of z_i, negative if bit i of pattern p is set
+static long long z_lit (int i, int p) {
+  long long var = next_exp - num_z + i + 1;
+  return (p >> i) & 1 ? -var : var;
+}
+
+// Resolves the units of each group of the last level with one leaf per
+// sign pattern over z, and these clauses to the empty clause
+static void last_level () {
+  int p, i, j, m, first = 0, num_patterns = 1 << num_z;
+  long long id;
+
+  if (mode == VARS && num_z) {
+    fprintf (proof, "x");
+    for (i = 0; i < num_z; i++) fprintf (proof, " %lld", next_exp + i + 1);
+    fprintf (proof, " 0");
+    for (i = 0; i < num_z; i++) fprintf (proof, " %d", z_base + i);
+    fprintf (proof, " 0 0\n");
+  }
+  next_exp += num_z;
+
+  for (p = 0; p < num_patterns; p++) {
+    Group *g = groups + p % num_groups;
+    if (!(p % num_groups)) first = 0;
+    else first += g [-1].size;
+    id = ++next_proof;
+    ++next_orig;
+    if (mode == CLAUSES) {
+      for (j = 0; j < g->size; j++) fprintf (qbf, "%d ", -(level_base [levels] + j));
+      for (i = 0; i < num_z; i++) fprintf (qbf, "%d ", (p >> i) & 1 ? -(z_base + i) : z_base + i);
+      fprintf (qbf, "0\n");
+      fprintf (proof, "%lld", id);
+      for (j = 0; j < g->size; j++) fprintf (proof, " %lld", -exp_vars [first + j]);
+      for (i = 0; i < num_z; i++) fprintf (proof, " %lld", z_lit (i, p));
+      fprintf (proof, " 0 %lld 0\n", next_orig);
+    }
+    for (j = 0; j < g->size; j++) {
+      ++next_proof;
+      if (mode != CLAUSES) continue;
+      fprintf (proof, "%lld", next_proof);
+      for (m = j + 1; m < g->size; m++) fprintf (proof, " %lld", -exp_vars [first + m]);
+      for (i = 0; i < num_z; i++) fprintf (proof, " %lld", z_lit (i, p));
+      fprintf (proof, " 0 %lld %lld 0\n", next_proof - 1, units [first + j]);
+    }
+    goals [p] = next_proof;
+  }
+
+  // Patterns differing in bit i are resolved on z_i
+  for (i = 0; i < num_z; i++) {
+    for (p = 0; p < num_patterns >> (i + 1); p++) {
+      id = ++next_proof;
+      if (mode == CLAUSES) {
+        fprintf (proof, "%lld", id);
+        for (j = i + 1; j < num_z; j++) fprintf (proof, " %lld", z_lit (j, p << (i + 1)));
+        fprintf (proof, " 0 %lld %lld 0\n", goals [2 * p], goals [2 * p + 1]);
+      }
+      goals [p] = id;
+    }
+  }
+}
+
+static void generate (int m) {
+  int k;
+
+  mode = m;
+  rng = seed * 0x9e3779b97f4a7c15ULL + 0x2545f4914f6cdd1dULL;
+  next_orig = next_proof = next_exp = 0;
+  first_level ();
+  for (k = 1; k <= levels; k++) next_level (k);
+  if (mode == COUNT) {
+    for (num_z = 0; (1 << num_z) < num_groups; num_z++)
+      ;
+    num_orig = next_orig + (1 << num_z);
+    goals = alloc (sizeof (long long) << num_z);
+  } else last_level ();
+}
+
+// Numbers the variables in prefix order: E0 (z first), A1, E1, ..., Ad, Ed
+static void print_prefix () {
+  int b, k, i, u, n = 1;
+
+  for (k = 0, b = 0; b <= depth; b++) {
+    if (b) {
+      fprintf (qbf, "a");
+      for (u = univ_first [b]; u < univ_first [b + 1]; u++) {
+        univ_var [u] = n++;
+        fprintf (qbf, " %d", univ_var [u]);
+      }
+      fprintf (qbf, " 0\n");
+    }
+    fprintf (qbf, "e");
+    if (!b) {
+      z_base = n;
+      for (i = 0; i < num_z; i++) fprintf (qbf, " %d", n++);
+    }
+    for (; k <= levels && block_of_level (k) == b; k++) {
+      level_base [k] = n;
+      for (i = 0; i < level_size [k]; i++) fprintf (qbf, " %d", n++);
+    }
+    fprintf (qbf, " 0\n");
+  }
+  assert (n - 1 == num_vars);
+}
+
+static int read_int (char *arg) {
+  char *end;
+  long res = strtol (arg ? arg : "", &end, 10);
+  if (!arg || *end || res < 0 || res > (1 << 30)) die ("invalid number '%s'", arg ? arg : "");
+  return res;
+}
+
+int main (int argc, char **argv) {
+  char *files [2];
+  int i, b, k, num_files = 0;
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp (argv [i], "-h") || !strcmp (argv [i], "--help")) {
+      fputs (usage, stdout);
+      return 0;
+    } else if (!strcmp (argv [i], "-u")) num_univ = read_int (argv [++i]);
+    else if (!strcmp (argv [i], "-d")) depth = read_int (argv [++i]);
+    else if (!strcmp (argv [i], "-a")) width_split = read_int (argv [++i]);
+    else if (!strcmp (argv [i], "-l")) levels = read_int (argv [++i]);
+    else if (!strcmp (argv [i], "-w")) width = read_int (argv [++i]);
+    else if (!strcmp (argv [i], "-r")) reuse = read_int (argv [++i]);
+    else if (!strcmp (argv [i], "-s")) seed = read_int (argv [++i]);
+    else if (argv [i][0] == '-') die ("invalid option '%s' (try '-h')", argv [i]);
+    else if (num_files < 2) files [num_files++] = argv [i];
+    else die ("invalid number of arguments");
+  }
+  if (num_files != 2) die ("invalid number of arguments");
+  if (depth < 1 || num_univ < depth) die ("need at least one universal per block");
+  if (levels < depth) die ("need at least as many levels as universal blocks");
+  if (width < 1 || reuse < 1 || width_split < 1) die ("width, reuse and annotations must be positive");
+
+  univ_first = alloc (sizeof (int) * (depth + 2));
+  for (b = 1; b <= depth; b++)
+    univ_first [b + 1] = univ_first [b] + num_univ / depth + (b - 1 < num_univ % depth);
+  univ_var = alloc (sizeof (int) * num_univ);
+  level_base = alloc (sizeof (int) * (levels + 1));
+  level_size = alloc (sizeof (int) * (levels + 1));
+  groups = alloc (sizeof (Group) * width);
+  next_groups = alloc (sizeof (Group) * width);
+  for (i = 0; i < width; i++) {
+    groups [i].tau = alloc (num_univ);
+    next_groups [i].tau = alloc (num_univ);
+  }
+  units = alloc (sizeof (long long) * width);
+  next_units = alloc (sizeof (long long) * width);
+  exp_vars = alloc (sizeof (long long) * width);
+  next_exp_vars = alloc (sizeof (long long) * width);
+
+  generate (COUNT);
+  for (num_vars = num_univ + num_z, k = 0; k <= levels; k++) num_vars += level_size [k];
+
+  if (!(qbf = fopen (files [0], "w"))) die ("could not write QBF %s", files [0]);
+  if (!(proof = fopen (files [1], "w"))) die ("could not write proof %s", files [1]);
+  fprintf (qbf, "c ferpgen -u %d -d %d -a %d -l %d -w %d -r %d -s %llu\n",
+           num_univ, depth, width_split, levels, width, reuse, seed);
+  fprintf (qbf, "p cnf %d %lld\n", num_vars, num_orig);
+  print_prefix ();
+  generate (VARS);
+  generate (CLAUSES);
+  if (fclose (qbf) || fclose (proof)) die ("could not write output");
+  fprintf (stderr, "ferpgen: %d variables, %lld clauses, %lld expansion variables, "
+           "%lld proof clauses\n", num_vars, num_orig, next_exp, next_proof);
+  return 0;
+}
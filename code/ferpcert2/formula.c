@@ -1,6 +1,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,21 +10,21 @@
 #include "admin.h"
 #include "formula.h"
 
-Scope *outer_most, *inner_most;
-Var *vars;
-Clause *clauses, *empty_clause;
-int num_vars, num_clauses;
-int universal_vars, existential_vars, implicit_vars, orig_clauses;
+TLS Scope *outer_most, *inner_most;
+TLS Var *vars;
+TLS Clause *clauses, *empty_clause;
+TLS int num_vars, num_clauses;
+TLS int universal_vars, existential_vars, implicit_vars, orig_clauses;
 
-int order = 1; 
-int max_var;
-int max_cl = 0;
+TLS int order = 1; 
+TLS int max_var;
+TLS int max_cl = 0;
 
-static int lineno = 1;
-static int remaining_clauses_to_parse;
-static char * line;
-static int nline, szline;
-static int remaining; 
+static TLS int lineno = 1;
+static TLS int remaining_clauses_to_parse;
+static TLS char * line;
+static TLS int nline, szline;
+static TLS int remaining; 
 
 
 static void init_vars_clauses (int vnum, int cnum) {
@@ -47,6 +48,11 @@ static int init_variables (int start) {
 
 
 
+// Ends the parse with 'msg' through die, like the proof parsers
+static void parse_error (const char *msg) {
+  die ("QBF line %d: %s", lineno, msg);
+}
+
 int parse_qbf (FILE * inFile) {
   int ch, m, n, i, c, q, lit, sign;
 
@@ -66,8 +72,7 @@ SKIP:
     line[nline = 0] = 0;
     while ((ch = getc (inFile)) != '\n') {
       if (ch == EOF) {
-        printf( "end of file in comment");
-        return 1;
+        parse_error ("end of file in comment");
       }
       if (nline + 1 == szline) {
         RSZ (line, szline, 2*szline);
@@ -82,8 +87,7 @@ SKIP:
 
   if (ch != 'p') {
 HERR:
-    printf ("invalid or missing header");
-    return 1;
+    parse_error ("invalid or missing header");
   }
 
  if (getc (inFile) != ' ') goto HERR;
@@ -97,15 +101,19 @@ HERR:
     ;
   if (!isdigit (ch)) goto HERR;
   m = ch - '0';
-  while (isdigit (ch = getc (inFile)))
+  while (isdigit (ch = getc (inFile))) {
+    if (m > (INT_MAX - 9) / 10) goto HERR;
     m = 10 * m + (ch - '0');
+  }
   if (ch != ' ') goto HERR;
   while ((ch = getc (inFile)) == ' ')
     ;
   if (!isdigit (ch)) goto HERR;
   n = ch - '0';
-  while (isdigit (ch = getc (inFile)))
+  while (isdigit (ch = getc (inFile))) {
+    if (n > (INT_MAX - 9) / 10) goto HERR;
     n = 10 * n + (ch - '0');
+  }
   while (ch != '\n')
     if (ch != ' ' && ch != '\t' && ch != '\r') goto HERR;
     else ch = getc (inFile);
@@ -114,7 +122,7 @@ HERR:
 
   init_vars_clauses(m, n);
 
-  init_variables (1);
+  if (m) init_variables (1);
   remaining_clauses_to_parse = n;
 
 
@@ -125,16 +133,14 @@ NEXT:
    if (ch == 'c') {
      while ((ch = getc (inFile)) != '\n')
        if (ch == EOF) {
-         printf ( "end of file in comment");
-         return 1;
+         parse_error ("end of file in comment");
        }
      lineno++;
      goto NEXT;
    }
    if (ch == EOF) {
      if (i < n) {
-       printf( "clauses missing");
-       return 1;
+       parse_error ("clauses missing");
      }
      orig_clauses = i;
      //if (!q && !c) ; // todo handle free vars
@@ -142,69 +148,61 @@ NEXT:
    }
    if (ch == '-') {
      if (q) {
-       printf ("negative number in prefix");
-       return 1;
+       parse_error ("negative number in prefix");
      }
      sign = -1;
      ch = getc (inFile);
      if (ch == '0') {
-       printf("'-' followed by '0'");
-       return 1;
+       parse_error ("'-' followed by '0'");
      }
    } else sign = 1;
    if (ch == 'e') {
      if (c) {
-       printf("'e' after at least one clause");
-       return 1;
+       parse_error ("'e' after at least one clause");
      }
      if (q) {
-       printf( "'0' missing after 'e'");
-       return 1;
+       parse_error ("'0' missing after 'e'");
      }
      q = 1;
      goto NEXT;
    }
    if (ch == 'a') {
      if (c) {
-       printf("'a' after at least one clause");
-       return 1;
+       parse_error ("'a' after at least one clause");
      }
      if (q) {
-       printf ( "'0' missing after 'a'");
-       return 1;
+       parse_error ("'0' missing after 'a'");
      }
      q = -1;
      goto NEXT;
   }
    if (!isdigit (ch)) {
-     printf ("expected digit");
-     return 1;
+     parse_error ("expected digit");
    }
    lit = ch - '0';
-   while (isdigit (ch = getc (inFile)))
+   while (isdigit (ch = getc (inFile))) {
+     if (lit > m / 10) {
+       parse_error ("maximum variable index exceeded");
+     }
      lit = 10 * lit + (ch - '0');
+   }
    if (ch != EOF && ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r') {
-     printf ("expected space after literal");
-     return 1;
+     parse_error ("expected space after literal");
    }
    if (ch == '\n') lineno++;
    if (lit > m) {
-     printf("maximum variable index exceeded");
-     return 1;
+     parse_error ("maximum variable index exceeded");
    }
    if (!q && i == n) {
-     printf( "too many clauses");
-     return 1;
+     parse_error ("too many clauses");
    }
    if (q) {
      if (lit) {
        if (sign < 0) {
-         printf ( "negative literal quantified");
-         return 1;
+         parse_error ("negative literal quantified");
        }
        if (lit2scope (lit)) {
-            printf ("variable quantified twice");
-            return 1;
+            parse_error ("variable quantified twice");
        }
        lit *= q;
        add_quantifier (lit);
@@ -233,6 +231,7 @@ NEXT:
    goto NEXT;
 DONE:
   free (line); 
+  line = NULL;
   return 0;
 
 }
@@ -404,6 +403,31 @@ void release () {
 
   free (clauses); 
   free (vars); 
+  free (line);   // left by a parse ended by die
+  line = NULL;
 
 
 }
+
+void formula_state (Visit visit) {
+  VISIT (outer_most);
+  VISIT (inner_most);
+  VISIT (vars);
+  VISIT (clauses);
+  VISIT (empty_clause);
+  VISIT (num_vars);
+  VISIT (num_clauses);
+  VISIT (universal_vars);
+  VISIT (existential_vars);
+  VISIT (implicit_vars);
+  VISIT (orig_clauses);
+  VISIT (order);
+  VISIT (max_var);
+  VISIT (max_cl);
+  VISIT (lineno);
+  VISIT (remaining_clauses_to_parse);
+  VISIT (line);
+  VISIT (nline);
+  VISIT (szline);
+  VISIT (remaining);
+}
@@ -1,6 +1,8 @@
 #ifndef FORMULA_H
 #define FORMULA_H
 
+#include "admin.h"
+
 typedef enum QType QType;
 typedef struct Scope Scope;
 typedef struct Var Var;
@@ -50,11 +52,11 @@ struct Clause {
 
 
 
-extern Scope *outer_most, *inner_most;
-extern Var *vars;
-extern Clause *clauses, *empty_clause;
-extern int num_vars, num_clauses;
-extern int universal_vars, existential_vars, implicit_vars, orig_clauses;
+extern TLS Scope *outer_most, *inner_most;
+extern TLS Var *vars;
+extern TLS Clause *clauses, *empty_clause;
+extern TLS int num_vars, num_clauses;
+extern TLS int universal_vars, existential_vars, implicit_vars, orig_clauses;
 
 
 void add_quantifier (int);
@@ -67,5 +69,6 @@ int fresh_var ();
 void release (); 
 void enlarge_clauses ();
 int parse_qbf (FILE *); 
+void formula_state (Visit);
 
 #endif
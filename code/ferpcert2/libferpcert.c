@@ -0,0 +1,214 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "formula.h"
+#include "admin.h"
+#include "proof.h"
+#include "checkpoint.h"
+#include "compress.h"
+#include "extract.h"
+#include "minimize.h"
+#include "profile.h"
+#include "stats.h"
+#include "uset.h"
+#include "libferpcert.h"
+
+/* The modules keep their state in thread-local variables. A context holds
+ * a copy of that state between calls: a call swaps the state of the context
+ * in and swaps it out again on return, which leaves the initial state, the
+ * same in every thread, behind. Contexts may thus be interleaved on one
+ * thread and move between threads. Errors raised by die() return to the
+ * call through die_jump; memory allocated by a failed call may be lost. */
+
+struct ferpcert {
+  char *state;
+  int qbf, proof, extracted, failed;
+  int compress;
+  double minimize;
+  char error [256];
+};
+
+static void (* const modules []) (Visit) = {
+  admin_state, checkpoint_state, compress_state, extract_state,
+  formula_state, minimize_state, profile_state, proof_state, stats_state,
+  uset_state
+};
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static char *initial;   // state of a thread before any call
+static size_t state_size;
+static TLS char *cursor;
+
+static void measure (void *p, size_t n) {
+  state_size += n;
+}
+
+static void save (void *p, size_t n) {
+  memcpy (cursor, p, n);
+  cursor += n;
+}
+
+static void restore (void *p, size_t n) {
+  memcpy (p, cursor, n);
+  cursor += n;
+}
+
+static void visit_all (Visit visit, char *state) {
+  unsigned i;
+  cursor = state;
+  for (i = 0; i < sizeof modules / sizeof *modules; i++) modules [i] (visit);
+}
+
+// Saves the initial state once, in the first thread calling
+static void save_initial () {
+  visit_all (measure, NULL);
+  if ((initial = malloc (state_size))) visit_all (save, initial);
+}
+
+static int init_state () {
+  pthread_once (&once, save_initial);
+  return initial != NULL;
+}
+
+static int error (ferpcert *ctx, const char *msg, const char *arg) {
+  snprintf (ctx->error, sizeof ctx->error, msg, arg);
+  return 1;
+}
+
+// Outside die_jump, so a failure is returned, not raised
+static int enter (ferpcert *ctx) {
+  if (!init_state ()) return error (ctx, "%s", "out of memory");
+  visit_all (restore, ctx->state);
+  return 0;
+}
+
+static void leave (ferpcert *ctx) {
+  visit_all (save, ctx->state);
+  visit_all (restore, initial);
+}
+
+ferpcert * ferpcert_new () {
+  ferpcert *ctx;
+
+  if (!init_state ()) return NULL;
+  if (!(ctx = calloc (1, sizeof *ctx))) return NULL;
+  if (!(ctx->state = malloc (state_size))) {
+    free (ctx);
+    return NULL;
+  }
+  memcpy (ctx->state, initial, state_size);
+  ctx->minimize = -1;
+  return ctx;
+}
+
+void ferpcert_delete (ferpcert *ctx) {
+  if (!ctx) return;
+  if (!enter (ctx)) {
+    release_lits ();
+    if (ctx->proof) proof_release ();
+    if (ctx->qbf) release ();
+    leave (ctx);
+  }
+  free (ctx->state);
+  free (ctx);
+}
+
+const char * ferpcert_error (ferpcert *ctx) {
+  return ctx->error;
+}
+
+int ferpcert_set_option (ferpcert *ctx, const char *name, double value) {
+  if (!strcmp (name, "check")) {
+    if (enter (ctx)) return 1;
+    check_proof = value != 0;
+    leave (ctx);
+  } else if (!strcmp (name, "compress")) {
+    ctx->compress = value != 0;
+  } else if (!strcmp (name, "minimize")) {
+    ctx->minimize = value;
+  } else return error (ctx, "invalid option '%s'", name);
+  return 0;
+}
+
+// Parses a QBF or a proof and closes 'file'
+static int parse (ferpcert *ctx, FILE *file, int proof) {
+  jmp_buf jump;
+  int res;
+
+  if (ctx->failed) res = error (ctx, "%s", "an earlier call failed");
+  else if (proof && !ctx->qbf) res = error (ctx, "%s", "no QBF read before the proof");
+  else if (proof ? ctx->proof : ctx->qbf)
+    res = error (ctx, "%s already read", proof ? "proof" : "QBF");
+  else if (!(res = enter (ctx))) {
+    die_jump = &jump;
+    if (setjmp (jump)) res = error (ctx, "%s", die_message);
+    else if ((res = proof ? parse_proof (file) : parse_qbf (file)))
+      error (ctx, "could not parse %s", proof ? "proof" : "QBF");
+    die_jump = NULL;
+    ctx->failed = res;
+    if (proof) ctx->proof = 1;
+    else ctx->qbf = 1;
+    leave (ctx);
+  }
+  fclose (file);
+  return res;
+}
+
+int ferpcert_read_qbf (ferpcert *ctx, const char *path) {
+  FILE *file = fopen (path, "r");
+  if (!file) return error (ctx, "could not open QBF %s", path);
+  return parse (ctx, file, 0);
+}
+
+int ferpcert_read_qbf_buffer (ferpcert *ctx, const char *buffer, size_t size) {
+  FILE *file = size ? fmemopen ((void *) buffer, size, "r") : NULL;
+  if (!file) return error (ctx, "%s", "could not read QBF from buffer");
+  return parse (ctx, file, 0);
+}
+
+int ferpcert_read_proof (ferpcert *ctx, const char *path) {
+  FILE *file = fopen (path, "r");
+  if (!file) return error (ctx, "could not open proof %s", path);
+  return parse (ctx, file, 1);
+}
+
+int ferpcert_read_proof_buffer (ferpcert *ctx, const char *buffer, size_t size) {
+  FILE *file = size ? fmemopen ((void *) buffer, size, "r") : NULL;
+  if (!file) return error (ctx, "%s", "could not read proof from buffer");
+  return parse (ctx, file, 1);
+}
+
+simpleaig * ferpcert_extract (ferpcert *ctx) {
+  simpleaig *aig = NULL;
+  jmp_buf jump;
+
+  if (ctx->failed) {
+    error (ctx, "%s", "an earlier call failed");
+    return NULL;
+  }
+  if (!ctx->proof) {
+    error (ctx, "%s", "no proof read");
+    return NULL;
+  }
+  if (ctx->extracted) {
+    error (ctx, "%s", "strategy already extracted");
+    return NULL;
+  }
+  if (enter (ctx)) return NULL;
+  die_jump = &jump;
+  if (setjmp (jump)) {
+    ctx->failed = error (ctx, "%s", die_message);
+    aig = NULL;
+  } else {
+    if (ctx->compress) compress_proof ();
+    aig = extract ();
+    if (ctx->minimize >= 0) aig = minimize_strategy (aig, ctx->minimize);
+  }
+  die_jump = NULL;
+  ctx->extracted = 1;
+  leave (ctx);
+  return aig;
+}
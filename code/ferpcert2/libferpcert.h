@@ -0,0 +1,33 @@
+#ifndef LIBFERPCERT_H
+#define LIBFERPCERT_H
+
+#include <stddef.h>
+
+#include "simpleaig.h"
+
+/* Library interface of ferpcert. A context holds one instance: its QBF,
+ * its FERP proof and the options. Contexts are independent, so instances
+ * can be certified concurrently in one process, one thread per context at
+ * a time. Functions returning int return 0 on success; the message of an
+ * error is then available from ferpcert_error. */
+
+typedef struct ferpcert ferpcert;
+
+ferpcert * ferpcert_new ();
+void ferpcert_delete (ferpcert *);
+const char * ferpcert_error (ferpcert *);
+
+// "check" (check the proof while parsing it), "compress" and "minimize"
+// (time limit in seconds, negative for none)
+int ferpcert_set_option (ferpcert *, const char *, double);
+
+int ferpcert_read_qbf (ferpcert *, const char *);
+int ferpcert_read_qbf_buffer (ferpcert *, const char *, size_t);
+int ferpcert_read_proof (ferpcert *, const char *);
+int ferpcert_read_proof_buffer (ferpcert *, const char *, size_t);
+
+// The strategy as a new AIG owned by the caller, NULL on error. The proof
+// is consumed, so this can be called once per context.
+simpleaig * ferpcert_extract (ferpcert *);
+
+#endif
@@ -0,0 +1,238 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/* Microbenchmarks of the AIG primitives and the parsers (make bench).
+ * Every benchmark runs on inputs drawn with a fixed seed for a sweep of sizes
+ * and reports ns/op, ops/s and, where perf events are available, cache
+ * misses per operation. The parsers run in a child process each since
+ * their state is global; their inputs are generated by ferpgen. */
+
+#include "extract.h"
+
+#define NUM_INPUTS 64
+
+static unsigned long long rng;
+static int perf_fd = -1;
+static char tmp_dir [] = "/tmp/microbench-XXXXXX";
+
+static unsigned long long next_random () {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return rng;
+}
+
+static double now () {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void perf_open () {
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset (&attr, 0, sizeof attr);
+  attr.size = sizeof attr;
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  perf_fd = syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static void perf_start () {
+#ifdef __linux__
+  if (perf_fd < 0) return;
+  ioctl (perf_fd, PERF_EVENT_IOC_RESET, 0);
+  ioctl (perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+static long long perf_stop () {
+  long long count = -1;
+#ifdef __linux__
+  if (perf_fd < 0) return -1;
+  ioctl (perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+  if (read (perf_fd, &count, sizeof count) != sizeof count) count = -1;
+#endif
+  return count;
+}
+
+static double start_time;
+
+static void start () {
+  perf_start ();
+  start_time = now ();
+}
+
+static void stop (const char *name, long long size, long long ops) {
+  double seconds = now () - start_time;
+  long long misses = perf_stop ();
+
+  printf ("%-22s %10lld %12lld %10.1f %14.0f", name, size, ops,
+          ops ? seconds * 1e9 / ops : 0, seconds > 0 ? ops / seconds : 0);
+  if (misses >= 0) printf (" %12.2f\n", ops ? (double) misses / ops : 0);
+  else printf (" %12s\n", "-");
+  fflush (stdout);
+}
+
+static int random_lit (int max) {
+  int var = 1 + next_random () % max;
+  return next_random () & 1 ? -var : var;
+}
+
+// An AIG of n gates over random earlier literals
+static simpleaig * random_aig (int n) {
+  simpleaig *res = simpleaig_init ();
+  int i;
+
+  for (i = 1; i <= NUM_INPUTS; i++) simpleaig_add_input (res, i);
+  res->lhs_aux = NUM_INPUTS + 1;
+  for (i = 0; i < n; i++)
+    simpleaig_add_and (res, SIMPLEAIG_FALSE, random_lit (res->lhs_aux - 1),
+                       random_lit (res->lhs_aux - 1));
+  for (i = 0; i < 8 && i < n; i++) simpleaig_add_output (res, res->ands [n - 1 - i].lhs);
+  return res;
+}
+
+static void bench_add_and (int n, unsigned long long seed) {
+  simpleaig *a = simpleaig_init ();
+  int i, *rhs;
+
+  rng = seed;
+  NEWN (rhs, 2 * n);
+  for (i = 0; i < 2 * n; i++) rhs [i] = random_lit (NUM_INPUTS + i / 2);
+  simpleaig_set_buckets (a, n);
+  a->lhs_aux = NUM_INPUTS + 1;
+  start ();
+  for (i = 0; i < n; i++) simpleaig_add_and (a, SIMPLEAIG_FALSE, rhs [2 * i], rhs [2 * i + 1]);
+  stop ("simpleaig_add_and", n, n);
+
+  // The same gates again only hit the hash table
+  start ();
+  for (i = 0; i < n; i++) simpleaig_add_and (a, SIMPLEAIG_FALSE, rhs [2 * i], rhs [2 * i + 1]);
+  stop ("simpleaig_lookup", n, n);
+  free (rhs);
+  simpleaig_reset (a);
+}
+
+static void bench_make_ite (int n, unsigned long long seed) {
+  simpleaig *a;
+  int i, *pool, pool_size = NUM_INPUTS;
+
+  rng = seed;
+  a = simpleaig_init ();
+  simpleaig_set_buckets (a, 3 * n);
+  a->lhs_aux = NUM_INPUTS + 1;
+  use_aig (a);
+  NEWN (pool, n + NUM_INPUTS);
+  for (i = 0; i < NUM_INPUTS; i++) pool [i] = i + 1;
+  start ();
+  for (i = 0; i < n; i++) {
+    int c = pool [next_random () % pool_size], t = pool [next_random () % pool_size],
+        e = pool [next_random () % pool_size];
+    pool [pool_size++] = makeITE (next_random () & 1 ? c : simpleaig_not (c), t, e);
+  }
+  stop ("makeITE", n, n);
+  free (pool);
+  use_aig (NULL);
+  simpleaig_reset (a);
+}
+
+static void bench_aiger (int n, unsigned long long seed) {
+  char path [64];
+  simpleaig *a, *b;
+  const char *error;
+  int binary;
+  FILE *f;
+
+  rng = seed;
+  a = random_aig (n);
+  for (binary = 0; binary <= 1; binary++) {
+    sprintf (path, "%s/bench.%s", tmp_dir, binary ? "aig" : "aag");
+    if (!(f = fopen (path, "w"))) die ("could not write %s", path);
+    start ();
+    simpleaig_write_aiger_to_file (a, f, binary);
+    fflush (f);
+    stop (binary ? "write binary aiger" : "write ascii aiger", n, n);
+    fclose (f);
+
+    b = simpleaig_init ();
+    start ();
+    if ((error = simpleaig_read_aiger_from_file (b, path, 0)))
+      die ("could not read %s: %s", path, error);
+    stop (binary ? "read binary aiger" : "read ascii aiger", n, n);
+    simpleaig_reset (b);
+    remove (path);
+  }
+  simpleaig_reset (a);
+}
+
+// Parses a QBF and a FERP trace of ferpgen in a child process
+static void bench_parsers (int n, unsigned long long seed) {
+  char cmd [256], qbf [64], ferp [64];
+  int status, width = 100;
+  pid_t pid;
+  FILE *f;
+
+  sprintf (qbf, "%s/bench.qdimacs", tmp_dir);
+  sprintf (ferp, "%s/bench.ferp", tmp_dir);
+  sprintf (cmd, "./ferpgen -u 8 -d 2 -a 2 -r 2 -w %d -l %d -s %llu %s %s 2>/dev/null",
+           width, n / (3 * width) > 2 ? n / (3 * width) : 2, seed, qbf, ferp);
+  if (system (cmd)) die ("could not run ferpgen (make ferpgen)");
+
+  fflush (stdout);
+  if (!(pid = fork ())) {
+    if (!(f = fopen (qbf, "r"))) die ("could not read %s", qbf);
+    start ();
+    if (parse_qbf (f)) die ("could not parse %s", qbf);
+    stop ("parse_qbf", n, num_clauses);
+    fclose (f);
+    if (!(f = fopen (ferp, "r"))) die ("could not read %s", ferp);
+    start ();
+    if (parse_proof (f)) die ("could not parse %s", ferp);
+    stop ("parse_proof", n, num_p_clauses - 1);
+    fclose (f);
+    exit (0);
+  }
+  if (waitpid (pid, &status, 0) < 0 || status) exit (1);
+  remove (qbf);
+  remove (ferp);
+}
+
+int main (int argc, char **argv) {
+  unsigned long long seed = 1;
+  int n, max = 1000000;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strncmp (argv [i], "--max=", 6)) max = atoi (argv [i] + 6);
+    else if (!strncmp (argv [i], "--seed=", 7)) seed = strtoull (argv [i] + 7, NULL, 10);
+    else die ("usage: microbench [ --max=<size> ] [ --seed=<n> ]");
+  }
+  if (!seed) die ("seed must not be zero");
+  if (!mkdtemp (tmp_dir)) die ("could not create temporary directory");
+  perf_open ();
+
+  printf ("%-22s %10s %12s %10s %14s %12s\n", "benchmark", "size", "ops",
+          "ns/op", "ops/s", "misses/op");
+  for (n = 10000; n <= max; n *= 10) {
+    bench_add_and (n, seed);
+    bench_make_ite (n, seed);
+    bench_aiger (n, seed);
+    bench_parsers (n, seed);
+  }
+  rmdir (tmp_dir);
+  return 0;
+}
@@ -0,0 +1,671 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "minimize.h"
+
+/* Care-set based minimisation of the strategy (--minimize). The Herbrand
+ * functions only have to falsify the matrix, so a gate may change its value
+ * on every assignment to the existentials for which the matrix stays false
+ * when the gate is flipped. These care sets are computed by simulating the
+ * strategy together with the original clauses.
+ *
+ * Up to MINIMIZE_EXACT_INPUTS existentials all assignments are simulated,
+ * which keeps the minimisation exact. Beyond, a sample is simulated: random
+ * assignments, replaced by models of the matrix found by a small DPLL
+ * search during the first quarter of the time limit, since the care sets
+ * are rarely hit otherwise. The minimised strategy is then checked by the
+ * same search on the matrix together with the gates of the strategy. A
+ * model is a counterexample, which is added to the sample before the
+ * original strategy is minimised again. The result is reported as verified
+ * if the search finishes without a model, and as not verified if the time
+ * limit ends it first.
+ *
+ * Gates are visited from the outputs towards the inputs. A gate is replaced
+ * by a constant or by an earlier signal that agrees with it on its care
+ * set, after which gates without fanout are dropped when the AIG is
+ * rebuilt. */
+
+#define MINIMIZE_EXACT_INPUTS 16
+#define MINIMIZE_SAMPLE_WORDS 64
+#define MINIMIZE_PATTERN_CONFLICTS 100
+#define MINIMIZE_MAX_WORDS (1 << 24)
+
+typedef unsigned long long Word;
+
+static TLS simpleaig *aig;
+static TLS simpleaigand *original;  // gates before minimisation
+static TLS clock_t start;
+static TLS double limit;
+static TLS int num_words;
+static TLS Word last_mask;
+static TLS Word *sim;     // simulation of each variable, num_words per variable
+static TLS Word *saved;
+static TLS Word *care;
+static TLS char *changed;
+static TLS int *refs;     // references from live gates and outputs
+static TLS char *dead;
+static TLS int *owner;    // first universal whose function uses each gate
+
+// DPLL search over the matrix and possibly the strategy, whose constant
+// true is the variable num_search_vars
+static TLS int num_search_vars, num_search_clauses;
+static TLS int *search_lits, *search_start;
+static TLS int *occ_start, *occs;  // clauses of each literal
+static TLS int *num_true, *num_false;
+static TLS signed char *value;
+static TLS int *trail, num_trail, head;
+static TLS int *order;    // variables in the order they are decided
+static TLS int *decision, *decision_next, num_decisions;
+static TLS signed char *flipped;
+static TLS unsigned long long rng;
+
+static int lit_var (int lit) {
+  return lit == SIMPLEAIG_TRUE ? 0 : abs (lit);
+}
+
+static Word lit_word (int lit, int w) {
+  if (lit == SIMPLEAIG_FALSE) return 0;
+  if (lit == SIMPLEAIG_TRUE) return ~0ULL;
+  if (lit < 0) return ~sim [(size_t) -lit * num_words + w];
+  return sim [(size_t) lit * num_words + w];
+}
+
+static Word mask (int w) {
+  return w == num_words - 1 ? last_mask : ~0ULL;
+}
+
+static int out_of_time (double fraction) {
+  return (double) (clock () - start) / CLOCKS_PER_SEC > limit * fraction;
+}
+
+static unsigned pick (unsigned n) {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return (unsigned) (rng % n);
+}
+
+static int lit_index (int lit) {
+  return 2 * abs (lit) + (lit < 0);
+}
+
+static int lit_value (int lit) {
+  return lit < 0 ? -value [-lit] : value [lit];
+}
+
+static int search_lit (int lit) {
+  if (lit == SIMPLEAIG_TRUE) return num_search_vars;
+  if (lit == SIMPLEAIG_FALSE) return -num_search_vars;
+  return lit;
+}
+
+static void add_search_clause (int a, int b, int c) {
+  int n = search_start [num_search_clauses];
+
+  search_lits [n++] = a;
+  if (b) search_lits [n++] = b;
+  if (c) search_lits [n++] = c;
+  search_start [++num_search_clauses] = n;
+}
+
+static void release_search () {
+  free (search_lits);
+  free (search_start);
+  free (occ_start);
+  free (occs);
+  free (num_true);
+  free (num_false);
+  free (value);
+  free (trail);
+  free (order);
+  free (decision);
+  free (decision_next);
+  free (flipped);
+  search_lits = search_start = occ_start = occs = num_true = num_false = NULL;
+  trail = order = decision = decision_next = NULL;
+  value = flipped = NULL;
+}
+
+// Sets up the search on the matrix, together with the live gates of the
+// strategy if 'strategy' is set
+static void build_search (int strategy) {
+  int c, j, n = 0, x, a, b;
+  unsigned i;
+
+  release_search ();
+  num_search_vars = aig->max_var + 1;
+  for (c = 0; c < num_clauses; c++) n += clauses [c].size;
+  NEWN (search_lits, n + (strategy ? 7 * (size_t) aig->num_ands + 1 : 0));
+  NEWN (search_start, num_clauses + (strategy ? 3 * (size_t) aig->num_ands + 1 : 0) + 1);
+  num_search_clauses = n = 0;
+  for (c = 0; c < num_clauses; c++) {
+    for (j = 0; j < clauses [c].size; j++) search_lits [n++] = clauses [c].lits [j];
+    search_start [++num_search_clauses] = n;
+  }
+  if (strategy) {
+    add_search_clause (num_search_vars, 0, 0);
+    for (i = 0; i < aig->num_ands; i++) {
+      if (dead [i]) continue;
+      x = aig->ands [i].lhs;
+      a = search_lit (aig->ands [i].rhs0);
+      b = search_lit (aig->ands [i].rhs1);
+      add_search_clause (-x, a, 0);
+      add_search_clause (-x, b, 0);
+      add_search_clause (x, -a, -b);
+    }
+  }
+
+  NEWN (occ_start, 2 * num_search_vars + 3);
+  NEWN (num_true, num_search_clauses);
+  NEWN (num_false, num_search_clauses);
+  for (j = 0; j < search_start [num_search_clauses]; j++)
+    occ_start [lit_index (search_lits [j]) + 1]++;
+  for (j = 1; j < 2 * num_search_vars + 3; j++) occ_start [j] += occ_start [j - 1];
+  NEWN (occs, search_start [num_search_clauses] + 1);
+  for (c = 0; c < num_search_clauses; c++)
+    for (j = search_start [c]; j < search_start [c + 1]; j++)
+      occs [occ_start [lit_index (search_lits [j])]++] = c;
+  for (j = 2 * num_search_vars + 2; j > 0; j--) occ_start [j] = occ_start [j - 1];
+  occ_start [0] = 0;
+
+  NEWN (value, num_search_vars + 1);
+  NEWN (trail, num_search_vars);
+  NEWN (order, num_search_vars);
+  NEWN (decision, num_search_vars);
+  NEWN (decision_next, num_search_vars);
+  NEWN (flipped, num_search_vars);
+  // Existentials are decided first, the strategy then follows by propagation
+  for (i = 0; i < aig->num_inputs; i++) {
+    order [i] = aig->inputs [i];
+    value [aig->inputs [i]] = 1;
+  }
+  for (x = 1; x <= num_search_vars; x++)
+    if (!value [x]) order [i++] = x;
+  for (i = 0; i < aig->num_inputs; i++) value [aig->inputs [i]] = 0;
+  num_trail = head = 0;
+}
+
+static void push (int lit) {
+  value [abs (lit)] = lit < 0 ? -1 : 1;
+  trail [num_trail++] = lit;
+}
+
+// Unit propagation, returns whether a clause became false
+static int propagate () {
+  int lit, c, i, j, size, conflict = 0;
+
+  while (head < num_trail) {
+    lit = trail [head++];
+    for (i = occ_start [lit_index (lit)]; i < occ_start [lit_index (lit) + 1]; i++)
+      num_true [occs [i]]++;
+    for (i = occ_start [lit_index (-lit)]; i < occ_start [lit_index (-lit) + 1]; i++) {
+      c = occs [i];
+      size = search_start [c + 1] - search_start [c];
+      if (++num_false [c] < size - 1 || num_true [c]) continue;
+      if (num_false [c] == size) conflict = 1;
+      else for (j = search_start [c]; j < search_start [c + 1]; j++)
+        if (!lit_value (search_lits [j])) push (search_lits [j]);
+    }
+    if (conflict) return 1;
+  }
+  return 0;
+}
+
+static void backtrack (int pos) {
+  int lit, i;
+
+  while (num_trail > pos) {
+    lit = trail [--num_trail];
+    value [abs (lit)] = 0;
+    if (num_trail >= head) continue;
+    for (i = occ_start [lit_index (lit)]; i < occ_start [lit_index (lit) + 1]; i++)
+      num_true [occs [i]]--;
+    for (i = occ_start [lit_index (-lit)]; i < occ_start [lit_index (-lit) + 1]; i++)
+      num_false [occs [i]]--;
+  }
+  if (head > pos) head = pos;
+}
+
+// DPLL with random decisions and chronological backtracking. Returns 1 if
+// a satisfying assignment was found, 0 if there is none and -1 if more
+// than 'max_conflicts' conflicts occurred or the time limit was reached.
+static int search_once (long max_conflicts) {
+  long conflicts = 0;
+  int next = 0, lit, c, t;
+  unsigned i;
+
+  backtrack (0);
+  num_decisions = 0;
+  for (c = 0; c < num_search_clauses; c++) {
+    if (search_start [c] == search_start [c + 1]) return 0;
+    lit = search_lits [search_start [c]];
+    if (search_start [c + 1] - search_start [c] == 1 && !lit_value (lit)) push (lit);
+  }
+  for (i = aig->num_inputs; i > 1; i--) {
+    t = order [i - 1];
+    c = pick (i);
+    order [i - 1] = order [c];
+    order [c] = t;
+  }
+  for (;;) {
+    if (propagate ()) {
+      while (num_decisions && flipped [num_decisions - 1]) num_decisions--;
+      if (!num_decisions) return 0;
+      if (++conflicts > max_conflicts || (!(conflicts & 1023) && out_of_time (1)))
+        return -1;
+      t = num_decisions - 1;
+      lit = trail [decision [t]];
+      backtrack (decision [t]);
+      flipped [t] = 1;
+      next = decision_next [t];
+      push (-lit);
+      continue;
+    }
+    while (next < num_search_vars && value [order [next]]) next++;
+    if (next == num_search_vars) return 1;
+    decision [num_decisions] = num_trail;
+    decision_next [num_decisions] = next;
+    flipped [num_decisions++] = 0;
+    push (pick (2) ? order [next] : -order [next]);
+  }
+}
+
+// Restarts the search with doubling conflict limits, which keeps it
+// complete, until it is decided or the time limit is reached
+static int search (long max_conflicts) {
+  long conflicts = MINIMIZE_PATTERN_CONFLICTS;
+  int res;
+
+  for (;;) {
+    if (conflicts > max_conflicts) conflicts = max_conflicts;
+    if ((res = search_once (conflicts)) >= 0) return res;
+    if (conflicts == max_conflicts || out_of_time (1)) return -1;
+    conflicts *= 2;
+  }
+}
+
+// Stores the existentials assigned by the search as pattern p
+static void store_pattern (size_t p) {
+  Word *word;
+  unsigned i;
+  int val;
+
+  for (i = 0; i < aig->num_inputs; i++) {
+    word = sim + (size_t) aig->inputs [i] * num_words + p / 64;
+    val = value [aig->inputs [i]];
+    if (val > 0) *word |= 1ULL << p % 64;
+    else if (val < 0) *word &= ~(1ULL << p % 64);
+  }
+}
+
+// Assigns the inputs all assignments if exact, otherwise random ones, which
+// are replaced by models of the matrix until a quarter of the time limit is
+// spent. The strategy has to falsify the matrix on those, so they hit the
+// care sets of the gates that decide which clause is falsified.
+static void simulate_inputs (int exact) {
+  unsigned i, k;
+  size_t p;
+  int w, res;
+
+  for (i = 0; i < aig->num_inputs; i++)
+    for (w = 0; w < num_words; w++)
+      for (k = 0; k < 64; k++)
+        if (exact ? (((size_t) w * 64 + k) >> i) & 1 : pick (2))
+          sim [(size_t) aig->inputs [i] * num_words + w] |= 1ULL << k;
+  if (exact) return;
+  build_search (0);
+  for (p = 0; p < (size_t) num_words * 64 && !out_of_time (0.25); p++) {
+    if ((res = search (MINIMIZE_PATTERN_CONFLICTS)) > 0) store_pattern (p);
+    else if (!res) break;
+  }
+}
+
+// Recomputes the gates from index 'from' on that depend on variable 'x'
+static void resimulate (int from, int x) {
+  unsigned i;
+  int w;
+
+  changed [x] = 1;
+  for (i = from; i < aig->num_ands; i++) {
+    simpleaigand *and = aig->ands + i;
+    if (dead [i]) continue;
+    if (!changed [lit_var (and->rhs0)] && !changed [lit_var (and->rhs1)]) continue;
+    for (w = 0; w < num_words; w++)
+      sim [(size_t) and->lhs * num_words + w] =
+        lit_word (and->rhs0, w) & lit_word (and->rhs1, w);
+    changed [and->lhs] = 1;
+  }
+  changed [x] = 0;
+  for (i = from; i < aig->num_ands; i++) changed [aig->ands [i].lhs] = 0;
+}
+
+// Stores in 'care' the assignments on which the matrix is satisfied
+static void satisfied () {
+  int c, j, w;
+  Word f;
+
+  for (w = 0; w < num_words; w++) {
+    care [w] = 0;
+    for (c = 0; c < num_clauses; c++) {
+      f = ~0ULL;
+      for (j = 0; j < clauses [c].size && f; j++)
+        f &= ~lit_word (clauses [c].lits [j], w);
+      care [w] |= f;
+      if (care [w] == ~0ULL) break;
+    }
+    care [w] = ~care [w] & mask (w);
+  }
+}
+
+static int agrees (int lit, int x) {
+  int w;
+  for (w = 0; w < num_words; w++)
+    if ((lit_word (lit, w) ^ sim [(size_t) x * num_words + w]) & care [w])
+      return 0;
+  return 1;
+}
+
+static void unref (int lit) {
+  refs [lit_var (lit)]--;
+}
+
+static void ref (int lit) {
+  refs [lit_var (lit)]++;
+}
+
+static int substitute (int lit, int x, int r) {
+  if (lit == x) return r;
+  if (lit == -x) return simpleaig_not (r);
+  return lit;
+}
+
+// Returns a constant or earlier signal agreeing with the gate on its care
+// set, or x itself if there is none
+static int find_replacement (unsigned i) {
+  simpleaigand *g = aig->ands + i;
+  int x = g->lhs, r, sign;
+  unsigned j;
+
+  if (agrees (SIMPLEAIG_FALSE, x)) return SIMPLEAIG_FALSE;
+  if (agrees (SIMPLEAIG_TRUE, x)) return SIMPLEAIG_TRUE;
+  for (sign = 1; sign >= -1; sign -= 2) {
+    for (j = 0; j < aig->num_inputs; j++) {
+      // Only existentials the universal may depend on
+      if (vars [aig->inputs [j]].scope->order > vars [owner [i]].scope->order)
+        continue;
+      r = sign * aig->inputs [j];
+      if (agrees (r, x)) return r;
+    }
+    for (j = 0; j < i; j++) {
+      if (dead [j] || !refs [aig->ands [j].lhs]) continue;
+      r = sign * aig->ands [j].lhs;
+      if (agrees (r, x)) return r;
+    }
+  }
+  return x;
+}
+
+static int min_and (simpleaig *res, int a, int b) {
+  if (a == SIMPLEAIG_FALSE || b == SIMPLEAIG_FALSE) return SIMPLEAIG_FALSE;
+  if (a == SIMPLEAIG_TRUE) return b;
+  if (b == SIMPLEAIG_TRUE || a == b) return a;
+  if (a == simpleaig_not (b)) return SIMPLEAIG_FALSE;
+  return simpleaig_add_and (res, SIMPLEAIG_FALSE, a, b);
+}
+
+// Copies the live gates into a new AIG
+static simpleaig * rebuild () {
+  simpleaig *res = simpleaig_init ();
+  int *map, a, b;
+  unsigned i;
+
+  simpleaig_set_buckets (res, aig->num_ands ? aig->num_ands : 1);
+  res->lhs_aux = num_vars + 1;
+  for (i = 0; i < aig->num_inputs; i++) simpleaig_add_input (res, aig->inputs [i]);
+  for (i = 0; i < aig->num_outputs; i++) simpleaig_add_output (res, aig->outputs [i]);
+
+  NEWN (map, aig->max_var + 1);
+  for (i = 0; i < aig->num_inputs; i++) map [aig->inputs [i]] = aig->inputs [i];
+  for (i = 0; i < aig->num_ands; i++) {
+    simpleaigand *and = aig->ands + i;
+    if (dead [i]) continue;
+    a = and->rhs0;
+    b = and->rhs1;
+    if (a != SIMPLEAIG_TRUE && a != SIMPLEAIG_FALSE)
+      a = a < 0 ? simpleaig_not (map [-a]) : map [a];
+    if (b != SIMPLEAIG_TRUE && b != SIMPLEAIG_FALSE)
+      b = b < 0 ? simpleaig_not (map [-b]) : map [b];
+    if (and->lhs <= num_vars)
+      map [and->lhs] = simpleaig_add_and (res, and->lhs, a, b);
+    else map [and->lhs] = min_and (res, a, b);
+  }
+  free (map);
+  return res;
+}
+
+
+// One pass over the gates of the original strategy on the current sample.
+// Returns whether the time limit was reached.
+static int minimize_pass (int *resubstituted) {
+  unsigned i, k, num_ands = aig->num_ands;
+  int x, r, w, timeout = 0;
+
+  memcpy (aig->ands, original, sizeof (simpleaigand) * num_ands);
+  memset (refs, 0, sizeof (int) * (aig->max_var + 1));
+  memset (dead, 0, num_ands);
+  *resubstituted = 0;
+  for (i = 0; i < num_ands; i++) {
+    simpleaigand *and = aig->ands + i;
+    for (w = 0; w < num_words; w++)
+      sim [(size_t) and->lhs * num_words + w] =
+        lit_word (and->rhs0, w) & lit_word (and->rhs1, w);
+    ref (and->rhs0);
+    ref (and->rhs1);
+  }
+  for (i = 0; i < aig->num_outputs; i++) ref (aig->outputs [i]);
+
+  satisfied ();
+  for (w = 0; w < num_words; w++)
+    if (care [w]) die ("strategy does not falsify the matrix");
+
+  for (i = num_ands; i-- > 0; ) {
+    simpleaigand *g = aig->ands + i;
+    x = g->lhs;
+    if (!refs [x]) {
+      dead [i] = 1;
+      unref (g->rhs0);
+      unref (g->rhs1);
+      continue;
+    }
+    if (out_of_time (1)) {
+      timeout = 1;
+      break;
+    }
+
+    // Care set: assignments on which flipping the gate satisfies the matrix
+    memcpy (saved, sim + (size_t) x * num_words, sizeof (Word) * num_words);
+    for (w = 0; w < num_words; w++) sim [(size_t) x * num_words + w] = ~saved [w];
+    resimulate (i + 1, x);
+    satisfied ();
+    memcpy (sim + (size_t) x * num_words, saved, sizeof (Word) * num_words);
+    resimulate (i + 1, x);
+
+    r = find_replacement (i);
+    if (r == x || (g->rhs0 == r && g->rhs1 == r)) continue;
+    (*resubstituted)++;
+    for (w = 0; w < num_words; w++)
+      sim [(size_t) x * num_words + w] = lit_word (r, w);
+    resimulate (i + 1, x);
+    unref (g->rhs0);
+    unref (g->rhs1);
+    if (x <= num_vars) {
+      // Gates of universal outputs keep their variable
+      g->rhs0 = g->rhs1 = r;
+      ref (r);
+      ref (r);
+    } else {
+      for (k = i + 1; k < num_ands; k++) {
+        simpleaigand *and = aig->ands + k;
+        if (dead [k]) continue;
+        if (lit_var (and->rhs0) == x) { and->rhs0 = substitute (and->rhs0, x, r); ref (r); }
+        if (lit_var (and->rhs1) == x) { and->rhs1 = substitute (and->rhs1, x, r); ref (r); }
+      }
+      refs [x] = 0;
+      dead [i] = 1;
+    }
+  }
+  // Gates before the time limit may still have lost their fanout
+  while (timeout && i-- > 0) {
+    simpleaigand *g = aig->ands + i;
+    if (refs [g->lhs]) continue;
+    dead [i] = 1;
+    unref (g->rhs0);
+    unref (g->rhs1);
+  }
+  return timeout;
+}
+
+simpleaig * minimize_strategy (simpleaig *strategy, double seconds) {
+  int c, j, x, resubstituted, removed, timeout, exact, found = 0;
+  int counterexamples = 0;
+  unsigned i, num_ands;
+  const char *verdict;
+  char *defined;
+  simpleaig *res;
+
+  start = clock ();
+  limit = seconds;
+  aig = strategy;
+  num_ands = aig->num_ands;
+  exact = aig->num_inputs <= MINIMIZE_EXACT_INPUTS;
+  num_words = exact && aig->num_inputs > 6 ? 1 << (aig->num_inputs - 6) : 1;
+  if (exact && (size_t) (aig->max_var + 1) * num_words > MINIMIZE_MAX_WORDS)
+    exact = 0;
+  if (!exact) num_words = MINIMIZE_SAMPLE_WORDS;
+  if ((size_t) (aig->max_var + 1) * num_words > MINIMIZE_MAX_WORDS)
+    num_words = MINIMIZE_MAX_WORDS / (aig->max_var + 1);
+  if (!num_words) {
+    fprintf (stderr, "strategy minimisation skipped (%u gates)\n", num_ands);
+    return aig;
+  }
+  last_mask = !exact || aig->num_inputs >= 6 ? ~0ULL
+            : (1ULL << (1 << aig->num_inputs)) - 1;
+
+  // Every variable of the matrix must be an input or an output
+  NEWN (defined, aig->max_var + 1);
+  for (i = 0; i < aig->num_inputs; i++) defined [aig->inputs [i]] = 1;
+  for (i = 0; i < aig->num_outputs; i++) defined [abs (aig->outputs [i])] = 1;
+  for (c = 0; c < num_clauses; c++)
+    for (j = 0; j < clauses [c].size; j++)
+      if (abs (clauses [c].lits [j]) > aig->max_var ||
+          !defined [abs (clauses [c].lits [j])]) {
+        fprintf (stderr, "strategy minimisation skipped (free variable %d)\n",
+                 abs (clauses [c].lits [j]));
+        free (defined);
+        return aig;
+      }
+  free (defined);
+
+  NEWN (sim, (size_t) (aig->max_var + 1) * num_words);
+  NEWN (saved, num_words);
+  NEWN (care, num_words);
+  NEWN (changed, aig->max_var + 1);
+  NEWN (refs, aig->max_var + 1);
+  NEWN (dead, num_ands + 1);
+  NEWN (owner, num_ands + 1);
+  NEWN (original, num_ands + 1);
+  memcpy (original, aig->ands, sizeof (simpleaigand) * num_ands);
+
+  // The gates of each universal precede its output gate, universals in
+  // prefix order, so earlier gates are available to later universals
+  for (i = num_ands, x = 0; i-- > 0; ) {
+    if (aig->ands [i].lhs <= num_vars) x = aig->ands [i].lhs;
+    owner [i] = x;
+  }
+
+  rng = 88172645463325252ULL;
+  simulate_inputs (exact);
+  for (;;) {
+    timeout = minimize_pass (&resubstituted);
+    if (exact || !resubstituted) break;
+    build_search (1);
+    found = search (LONG_MAX);
+    if (found <= 0) break;
+    // Replace the patterns from the last one on, which are random if the
+    // search for models ran out of time
+    store_pattern ((size_t) num_words * 64 - 1 -
+                   counterexamples++ % ((size_t) num_words * 64));
+    if (timeout || out_of_time (1)) {
+      // No time for another pass
+      memcpy (aig->ands, original, sizeof (simpleaigand) * num_ands);
+      memset (dead, 0, num_ands);
+      resubstituted = 0;
+      break;
+    }
+  }
+  release_search ();
+  if (!resubstituted) verdict = "strategy kept";
+  else if (!found) verdict = "verified";
+  else verdict = "not verified";
+
+  res = rebuild ();
+  removed = (int) num_ands - (int) res->num_ands;
+  if (exact)
+    fprintf (stderr, "strategy minimisation: %d of %u gates removed "
+             "(%d resubstituted)%s\n", removed, num_ands, resubstituted,
+             timeout ? ", time limit reached" : "");
+  else
+    fprintf (stderr, "strategy minimisation: %d of %u gates removed "
+             "(%d resubstituted), care sets sampled, %d counterexamples, "
+             "%s\n", removed, num_ands, resubstituted, counterexamples, verdict);
+
+  free (sim);
+  free (saved);
+  free (care);
+  free (changed);
+  free (refs);
+  free (dead);
+  free (owner);
+  free (original);
+  original = NULL;
+  simpleaig_reset (aig);
+  return res;
+}
+
+void minimize_state (Visit visit) {
+  VISIT (aig);
+  VISIT (original);
+  VISIT (start);
+  VISIT (limit);
+  VISIT (num_words);
+  VISIT (last_mask);
+  VISIT (sim);
+  VISIT (saved);
+  VISIT (care);
+  VISIT (changed);
+  VISIT (refs);
+  VISIT (dead);
+  VISIT (owner);
+  VISIT (num_search_vars);
+  VISIT (num_search_clauses);
+  VISIT (search_lits);
+  VISIT (search_start);
+  VISIT (occ_start);
+  VISIT (occs);
+  VISIT (num_true);
+  VISIT (num_false);
+  VISIT (value);
+  VISIT (trail);
+  VISIT (num_trail);
+  VISIT (head);
+  VISIT (order);
+  VISIT (decision);
+  VISIT (decision_next);
+  VISIT (num_decisions);
+  VISIT (flipped);
+  VISIT (rng);
+}
@@ -0,0 +1,12 @@
+#ifndef MINIMIZE_H
+#define MINIMIZE_H
+
+#include "formula.h"
+#include "admin.h"
+#include "simpleaig.h"
+
+
+simpleaig * minimize_strategy (simpleaig *, double);
+void minimize_state (Visit);
+
+#endif
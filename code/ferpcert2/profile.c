@@ -0,0 +1,140 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+/* Gate provenance (--profile=<n>). Every AND gate requested by the
+ * extraction is attributed to the proof clause being processed and to the
+ * variable of the resolution step, either as a new gate or as a hit in the
+ * hash table of the AIG. The report lists the totals and the <n> clauses
+ * and pivot variables that created the most gates. */
+
+typedef struct {
+  long long created, shared;
+} Gates;
+
+TLS int profile;
+
+static TLS Gates *clause_gates;  // per proof clause
+static TLS Gates *pivot_gates;   // per original existential, 0 for leaves
+static TLS int *pivot_steps;
+static TLS int current_clause = -1, current_pivot;
+
+void profile_init () {
+  NEWN (clause_gates, num_p_clauses);
+  NEWN (pivot_gates, num_vars + 1);
+  NEWN (pivot_steps, num_vars + 1);
+}
+
+void profile_clause (int i) {
+  current_clause = i;
+  current_pivot = 0;
+}
+
+void profile_pivot (int pivot) {
+  current_pivot = a_vars [abs (pivot)].orig_ex_name;
+  pivot_steps [current_pivot]++;
+}
+
+void profile_gate (int created) {
+  Gates *c, *p;
+
+  if (current_clause < 0) return;
+  c = clause_gates + current_clause;
+  p = pivot_gates + current_pivot;
+  if (created) c->created++, p->created++;
+  else c->shared++, p->shared++;
+}
+
+static double rate (Gates *g) {
+  long long n = g->created + g->shared;
+  return n ? 100.0 * g->shared / n : 0;
+}
+
+static TLS Gates *sort_gates;
+
+static int cmp_gates (const void *a, const void *b) {
+  const Gates *g1 = sort_gates + *(const int *) a, *g2 = sort_gates + *(const int *) b;
+  if (g1->created != g2->created) return g1->created < g2->created ? 1 : -1;
+  return *(const int *) a - *(const int *) b;
+}
+
+// Indices of the at most 'profile' entries with the most created gates
+static int top (Gates *gates, int n, int *idx) {
+  int i, k = 0;
+  for (i = 0; i < n; i++)
+    if (gates [i].created || gates [i].shared) idx [k++] = i;
+  sort_gates = gates;
+  qsort (idx, k, sizeof (int), cmp_gates);
+  return k < profile ? k : profile;
+}
+
+void profile_report (FILE *out) {
+  Gates total = {0, 0}, leaves = {0, 0};
+  int i, j, k, *idx;
+
+  for (i = 0; i < num_p_clauses; i++) {
+    total.created += clause_gates [i].created;
+    total.shared += clause_gates [i].shared;
+    if (!p_clauses [i].p2) {
+      leaves.created += clause_gates [i].created;
+      leaves.shared += clause_gates [i].shared;
+    }
+  }
+  fprintf (out, "gate profile: %lld gates created, %lld shared (%.1f%%)\n",
+           total.created, total.shared, rate (&total));
+  fprintf (out, "  leaves: %lld created, %lld shared (%.1f%%)\n",
+           leaves.created, leaves.shared, rate (&leaves));
+
+  NEWN (idx, num_p_clauses > num_vars ? num_p_clauses : num_vars + 1);
+  k = top (clause_gates, num_p_clauses, idx);
+  fprintf (out, "top %d clauses:\n", k);
+  fprintf (out, "  %10s %8s %12s %12s %7s  parents\n",
+           "clause", "pivot", "created", "shared", "shared%");
+  for (i = 0; i < k; i++) {
+    P_Clause *c = p_clauses + idx [i];
+    fprintf (out, "  %10d %8d %12lld %12lld %6.1f%% ", idx [i],
+             c->p2 && !c->chain ? a_vars [abs (c->pivot)].orig_ex_name : 0,
+             clause_gates [idx [i]].created, clause_gates [idx [i]].shared,
+             rate (clause_gates + idx [i]));
+    if (!c->p2) fprintf (out, " leaf");
+    else if (c->chain) {
+      fprintf (out, " chain");
+      for (j = 0; j < c->chain_size; j++) fprintf (out, " %d", c->chain [j]);
+    } else fprintf (out, " %d %d", c->p1, c->p2);
+    fprintf (out, "\n");
+  }
+
+  k = top (pivot_gates + 1, num_vars, idx);
+  fprintf (out, "top %d pivot variables:\n", k);
+  fprintf (out, "  %10s %8s %12s %12s %7s\n", "variable", "steps", "created",
+           "shared", "shared%");
+  for (i = 0; i < k; i++) {
+    j = idx [i] + 1;
+    fprintf (out, "  %10d %8d %12lld %12lld %6.1f%%\n", j, pivot_steps [j],
+             pivot_gates [j].created, pivot_gates [j].shared,
+             rate (pivot_gates + j));
+  }
+  free (idx);
+}
+
+void profile_release () {
+  free (clause_gates);
+  free (pivot_gates);
+  free (pivot_steps);
+  clause_gates = pivot_gates = NULL;
+  pivot_steps = NULL;
+  current_clause = -1;
+}
+
+void profile_state (Visit visit) {
+  VISIT (profile);
+  VISIT (clause_gates);
+  VISIT (pivot_gates);
+  VISIT (pivot_steps);
+  VISIT (current_clause);
+  VISIT (current_pivot);
+  VISIT (sort_gates);
+}
@@ -0,0 +1,20 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+
+#include "formula.h"
+#include "admin.h"
+#include "proof.h"
+
+extern TLS int profile;
+
+void profile_init ();
+void profile_clause (int);
+void profile_pivot (int);
+void profile_gate (int);
+void profile_report (FILE *);
+void profile_release ();
+void profile_state (Visit);
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,11 +16,12 @@
 #define aiger_true SIMPLEAIG_TRUE
 #define aiger_false SIMPLEAIG_FALSE
 
-int a_vars_size, p_clauses_size;
-A_Var *a_vars;
-P_Clause *p_clauses;
-int p_empty_clause;
-int num_p_vars, num_p_clauses;
+TLS int a_vars_size, p_clauses_size;
+TLS A_Var *a_vars;
+TLS P_Clause *p_clauses;
+TLS int p_empty_clause;
+TLS int num_p_vars, num_p_clauses;
+TLS int check_proof;
 
 
 int avar_get_level (int l) {
@@ -57,8 +59,9 @@ void proof_release () {
   }
   for (i = 0; i < p_clauses_size; i++) {
     free (p_clauses [i].nodes);
-    free (p_clauses [i].universals);
     free (p_clauses [i].aig_labels);
+    free (p_clauses [i].chain);
+    free (p_clauses [i].pivots);
   }
  
   free (p_clauses); 
@@ -74,6 +77,10 @@ int a_lit2var (int l) {
 
 }
 
+static int plit2olit (int l) {
+  return l < 0 ? -a_lit2var (l) : a_lit2var (l);
+}
+
 static int cmpfunc (const void * a, const void * b) {
   const int *l1 = a, *l2 = b;
   int ov1, ov2; 
@@ -90,93 +97,255 @@ static int cmpfunc (const void * a, const void * b) {
 
 }
 
+// Size of a table grown to hold index 'sz', without overflowing an int
+static int grown_size (int size, int sz) {
+  long long n = size ? 2LL*size + sz : 1LL + sz;
+  if (sz == INT_MAX) die ("index %d too large", sz);
+  return n < INT_MAX ? n : INT_MAX;
+}
+
 void enlarge_proof_vars (int sz) {
-  int new_size_a_vars = a_vars_size ? (2*a_vars_size + sz) : (1+sz);
+  int new_size_a_vars = grown_size (a_vars_size, sz);
   RSZ (a_vars, a_vars_size, new_size_a_vars);
   a_vars_size = new_size_a_vars; 
 }
 
 void enlarge_proof_clauses (int sz) {
-  int new_size_p_clauses = p_clauses_size ? (2*p_clauses_size + sz) : (1+sz);
+  int new_size_p_clauses = grown_size (p_clauses_size, sz);
   RSZ (p_clauses, p_clauses_size, new_size_p_clauses);
   p_clauses_size = new_size_p_clauses;
 } 
 
-int parse_proof (FILE *f) {
-  int tmp, cl; 
-  int i, j, p1, p2; 
-  int lit, count_vars = 0, count_an; 
-  A_Var * next = NULL; 
-  int *annos, *lts; 
-  AnnotationNode *anode; 
+/* Checks of the FERP proof done while parsing (--check), which replace a
+ * separate run of ferpcheck. */
+
+// The annotation of an expansion variable only assigns universals that
+// precede its existential variable
+static void check_expansion_var (int x) {
+  A_Var *av = a_vars + x;
+  int i, lit, ok = 1;
+
+  if (av->orig_ex_name > num_vars || !vars [av->orig_ex_name].scope ||
+      is_universal (av->orig_ex_name))
+    die ("expansion variable %d of non-existential %d", x, av->orig_ex_name);
+
+  for (i = 0; i < av->ann_size; i++) {
+    lit = av->u_annotations [i];
+    if (abs(lit) > num_vars || !vars [abs(lit)].scope || !is_universal (lit) ||
+        lit2order (lit) > lit2order (av->orig_ex_name) || vars [abs(lit)].mark)
+      ok = 0;
+    else vars [abs(lit)].mark = lit;
+  }
+  for (i = 0; i < av->ann_size; i++) {
+    lit = av->u_annotations [i];
+    if (abs(lit) <= num_vars) vars [abs(lit)].mark = 0;
+  }
+  if (!ok)
+    die ("annotation of expansion variable %d does not match the prefix", x);
+}
 
-  num_p_clauses = 1; 
-  num_p_vars = 1; 
+// The resolvent is the union of its parents without the pivot
+static void check_resolvent (int cl) {
+  P_Clause *c = p_clauses + cl, *p;
+  int i, j, lit, pivot = 0, clashes = 0, count = 0, ok = 1;
 
-  assert (!num_lits); 
-  do {
-    tmp = fscanf (f, "x %d", &lit); 
-    if (tmp == EOF) break; 
+  for (i = 0; i < 2; i++) {
+    j = i ? c->p2 : c->p1;
+    if (j <= 0 || j >= cl || !p_clauses [j].name)
+      die ("invalid parent %d of clause %d", j, cl);
+  }
 
-    if (tmp <= 0) break; 
-    count_vars = 0; 
-    next = NULL; 
-    while (lit) {
-      if (lit <= 0) die ("error in parsing proof; expecting var, found lit"); 
-      push_literal (lit); 
-      count_vars++;
-      num_p_vars++; 
-      if (a_vars_size <= lit) enlarge_proof_vars (lit); 
+  for (i = 0; i < 2; i++) {
+    p = p_clauses + (i ? c->p2 : c->p1);
+    for (j = 0; j < p->size; j++) {
+      lit = p->nodes[j];
+      if (a_vars [abs(lit)].mark == -lit) {
+        if (i) pivot = -lit;
+        else ok = 0;
+        clashes++;
+      } else if (!a_vars [abs(lit)].mark) {
+        a_vars [abs(lit)].mark = lit;
+        count++;
+      }
+    }
+  }
+  if (clashes != 1) ok = 0;
+  else a_vars [abs(pivot)].mark = 0;
+  for (i = 0; ok && i < c->size; i++)
+    if (a_vars [abs(c->nodes[i])].mark != c->nodes[i]) ok = 0;
+
+  for (i = 0; i < 2; i++) {
+    p = p_clauses + (i ? c->p2 : c->p1);
+    for (j = 0; j < p->size; j++) a_vars [abs(p->nodes[j])].mark = 0;
+  }
+  if (!ok || c->size != count - 1)
+    die ("clause %d is not the resolvent of %d and %d", cl, c->p1, c->p2);
+}
 
-      (a_vars+lit)->next = next; 
-      next = &a_vars [lit]; 
+// A leaf instantiates its original clause under the assignment to the
+// universals given by the annotations of its literals, extended to falsify
+// the universal literals of the clause. Each annotation is the restriction
+// of that assignment to the universals preceding its variable.
+static void check_leaf (int cl) {
+  P_Clause *c = p_clauses + cl;
+  Clause *oc;
+  A_Var *av;
+  int i, j, k, lit, matched = 0, ok = 1, first = num_lits;
+
+  if (c->p1 <= 0 || c->p1 > orig_clauses)
+    die ("invalid original clause %d of clause %d", c->p1, cl);
+  oc = clauses + c->p1 - 1;
+
+  for (i = 0; i < c->size; i++) {
+    av = a_vars + abs(c->nodes[i]);
+    for (j = 0; j < av->ann_size; j++) {
+      lit = av->u_annotations [j];
+      if (vars [abs(lit)].mark == -lit) ok = 0;
+      if (vars [abs(lit)].mark) continue;
+      vars [abs(lit)].mark = lit;
+      push_literal (lit);
+    }
+    lit = plit2olit (c->nodes[i]);
+    if (vars [abs(lit)].mark) ok = 0;
+    vars [abs(lit)].mark = lit;
+  }
 
-      tmp = fscanf (f, "%d", &lit); 
+  for (i = 0; ok && i < oc->size; i++) {
+    lit = oc->lits[i];
+    if (!lit2scope (lit)) ok = 0;   // free variable
+    else if (is_universal (lit)) {
+      if (vars [abs(lit)].mark == lit) ok = 0;
+      if (vars [abs(lit)].mark) continue;
+      vars [abs(lit)].mark = -lit;
+      push_literal (-lit);
+    } else if (vars [abs(lit)].mark == lit) {
+      matched++;
+    } else ok = 0;
+  }
 
-      if (tmp <= 0) die ("error in parsing proof");     
-    }
+  for (i = 0; ok && i < c->size; i++) {
+    av = a_vars + abs(c->nodes[i]);
+    for (j = first, k = 0; j < num_lits; j++)
+      if (lit2order (lits[j]) < lit2order (av->orig_ex_name)) k++;
+    if (k != av->ann_size) ok = 0;
+  }
 
-    for (i = 0; i < count_vars; i++) {
-      tmp = fscanf (f, "%d", &lit); 
+  for (j = first; j < num_lits; j++) vars [abs(lits[j])].mark = 0;
+  for (i = 0; i < c->size; i++) vars [a_lit2var (c->nodes[i])].mark = 0;
+  num_lits = first;
+  if (!ok || matched != c->size)
+    die ("clause %d is not an instance of original clause %d", cl, c->p1);
+}
 
-      if (tmp <= 0) die ("error in parsing proof");     
-      if (lit <= 0) die ("error in parsing proof %d", lit); 
-      
-      a_vars[lits[i]].orig_ex_name = lit;     
-    }
+static void parse_expansion_vars (FILE *f, int lit) {
+  int tmp, i, j, count_vars, count_an; 
+  A_Var * next; 
+  int *annos; 
+  AnnotationNode *anode; 
+
+  count_vars = 0; 
+  next = NULL; 
+  while (lit) {
+    if (lit <= 0) die ("error in parsing proof; expecting var, found lit"); 
+    push_literal (lit); 
+    count_vars++;
+    num_p_vars++; 
+    if (a_vars_size <= lit) enlarge_proof_vars (lit); 
+    // The first variable of a line owns the annotation (proof_release)
+    if (a_vars [lit].orig_ex_name || a_vars [lit].mark)
+      die ("expansion variable %d declared twice", lit);
+    a_vars [lit].mark = 1;
+
+    (a_vars+lit)->next = next; 
+    next = &a_vars [lit]; 
+
+    tmp = fscanf (f, "%d", &lit); 
 
-    count_an = 0; 
+    if (tmp <= 0) die ("error in parsing proof");     
+  }
+  for (i = 0; i < count_vars; i++) a_vars [lits[i]].mark = 0;
+
+  for (i = 0; i < count_vars; i++) {
     tmp = fscanf (f, "%d", &lit); 
+
     if (tmp <= 0) die ("error in parsing proof");     
+    if (lit <= 0 || lit > num_vars) die ("error in parsing proof %d", lit); 
+    
+    a_vars[lits[i]].orig_ex_name = lit;     
+  }
 
+  count_an = 0; 
+  tmp = fscanf (f, "%d", &lit); 
+  if (tmp <= 0) die ("error in parsing proof");     
+
+  tmp = fscanf (f, "%d", &lit); 
+  if (tmp <= 0) die ("error in parsing proof");  
+ 
+  while (lit) {
+    if (abs(lit) > num_vars) die ("annotation literal %d out of range", lit);
+    count_an++; 
+    push_literal (lit); 
     tmp = fscanf (f, "%d", &lit); 
-    if (tmp <= 0) die ("error in parsing proof");  
-   
-    while (lit) {
-      count_an++; 
-      push_literal (lit); 
-      tmp = fscanf (f, "%d", &lit); 
-      if (tmp <= 0) die ("error in parsing proof");     
-    }
-    if (count_an) {
-      annos = malloc (sizeof(int) * count_an); 
-      for (i = 0; i < count_an; i++) annos[i] = lits [count_vars + i];     
-      for (i = 0; i < count_vars; i++) {
+    if (tmp <= 0) die ("error in parsing proof");     
+  }
+  if (count_an && count_vars) {
+    annos = malloc (sizeof(int) * count_an); 
+    for (i = 0; i < count_an; i++) annos[i] = lits [count_vars + i];     
+    for (i = 0; i < count_vars; i++) {
 	      a_vars [lits[i]].u_annotations = annos; 
 	      a_vars [lits[i]].ann_size = count_an; 
-      }
+    }
 
-      for (i = 0; i < count_an; i++) {
-        for (j = 0; j < count_vars; j++) {
+    for (i = 0; i < count_an; i++) {
+      for (j = 0; j < count_vars; j++) {
 	  if (lits [count_vars+i] < 0) continue; // neg annotations
-          anode = malloc (sizeof (AnnotationNode)); 
+        anode = malloc (sizeof (AnnotationNode)); 
 	  anode->ex_var = lits[j]; 
 	  anode->next = vars[lits [count_vars+i]].an; 
 	  vars[lits [count_vars+i]].an = anode; 
 	}
 
-      }
     }
+  }
+  if (check_proof)
+    for (i = 0; i < count_vars; i++) check_expansion_var (lits[i]);
+}
+
+static void set_pivot (int cl) {
+  int i, p1 = p_clauses[cl].p1, p2 = p_clauses[cl].p2; 
+
+  for (i = 0; i < p_clauses [p1].size; i++) {
+    a_vars [abs(p_clauses[p1].nodes[i])].mark =  p_clauses[p1].nodes[i]; 
+  }
+
+  for (i = 0; i < p_clauses [p2].size; i++) {
+    if (a_vars [abs(p_clauses[p2].nodes[i])].mark ==  -p_clauses[p2].nodes[i]) break;  
+  }
+
+  if (i == p_clauses [p2].size) die ("clauses %d and %d do not clash", p1, p2);
+
+  p_clauses[cl].pivot = -p_clauses[p2].nodes[i];
+  for (i = 0; i < p_clauses [p1].size; i++) {
+    a_vars [abs(p_clauses[p1].nodes[i])].mark = 0; 
+  }
+}
+
+int parse_proof (FILE *f) {
+  int tmp, cl; 
+  int i, p1, p2; 
+  int lit, count_vars = 0; 
+  int *lts; 
+
+  num_p_clauses = 1; 
+  num_p_vars = 1; 
+
+  assert (!num_lits); 
+  do {
+    tmp = fscanf (f, "x %d", &lit); 
+    if (tmp == EOF) break; 
+
+    if (tmp <= 0) break; 
+    parse_expansion_vars (f, lit); 
     tmp = fscanf (f, "\n"); 
     num_lits = 0; 
   } while (1); 
@@ -200,6 +369,8 @@ int parse_proof (FILE *f) {
       tmp = fscanf (f, "%d", &lit); 
       if (tmp <= 0) die ("error in parsing proof");     
       if (!lit) break; 
+      if (abs(lit) >= a_vars_size || !a_vars [abs(lit)].orig_ex_name)
+        die ("undeclared expansion variable %d in clause %d", lit, cl);
       push_literal (lit); 
       count_vars++; 
    } 
@@ -217,45 +388,466 @@ int parse_proof (FILE *f) {
    if (count_vars == 0) p_empty_clause = cl; 
  
    tmp = fscanf (f, "%d %d", &p1, &p2); 
+   if (tmp != 2) die ("error in parsing proof"); 
 
    if (p1 && p2) {  // two parents
+     if (p1 < 0 || p1 >= cl || !p_clauses [p1].name ||
+         p2 < 0 || p2 >= cl || !p_clauses [p2].name)
+       die ("invalid parents %d and %d of clause %d", p1, p2, cl);
      p_clauses[cl].p1 = p1; 
      p_clauses[cl].p2 = p2;
   
-     for (i = 0; i < p_clauses [p1].size; i++) {
-       a_vars [abs(p_clauses[p1].nodes[i])].mark =  p_clauses[p1].nodes[i]; 
-     }
-
-     for (i = 0; i < p_clauses [p2].size; i++) {
-       if (a_vars [abs(p_clauses[p2].nodes[i])].mark ==  -p_clauses[p2].nodes[i]) break;  
-     }
-
-     assert (i < p_clauses [p2].size); 
-
-     p_clauses[cl].pivot = -p_clauses[p2].nodes[i];
-     for (i = 0; i < p_clauses [p1].size; i++) {
-       a_vars [abs(p_clauses[p1].nodes[i])].mark = 0; 
-     }
+     if (check_proof) check_resolvent (cl);
+     set_pivot (cl); 
      tmp = fscanf (f, "%d", &lit); // process final zero
     
    } else {
     // Single parent
 
-    assert(p1 && !p2);
-    assert(p1 <= num_clauses);
+    if (p1 < 1 || p1 > orig_clauses || p2)
+      die ("invalid original clause %d of leaf %d", p1, cl);
     p_clauses[cl].p1 = p1;
     p_clauses[cl].p2 = 0;
+    if (check_proof) check_leaf (cl);
    }
 
    num_lits = 0; 
    if (p_empty_clause) break; 
   } while (1); 
 
-  assert (p_empty_clause+1 == num_p_clauses); 
+  if (check_proof && !p_empty_clause) die ("proof does not derive the empty clause");
+  if (p_empty_clause+1 != num_p_clauses)
+    die ("proof clauses are not numbered consecutively");
 
   return 0; 
 }
 
+/* Native input of ijtihad's expanded CNF (--log_phi) and a resolution
+ * trace, either binary (tracecheck -B) or with resolution chains (picosat
+ * -T), instead of the merged FERP trace of toferp.
+ * Expansion variables are declared in comments of the CNF, which use the
+ * syntax of the FERP header preceded by 'c', i.e.
+ *
+ *   c x <vars> 0 <original vars> 0 <annotation> 0
+ *
+ * Leaves of the trace carry no reference to the QBF, so the original clause
+ * they instantiate is looked up by its existential literals.
+ */
+
+static TLS int *orig_heads, *orig_next, orig_heads_size;
+static TLS int *orig_stamp, orig_stamp_size, orig_stamp_gen;
+
+static unsigned hash_lit (int lit) {
+  unsigned h = (unsigned) lit * 2654435761u;
+  return h ^ (h >> 15);
+}
+
+static void init_orig_index () {
+  int i, j;
+  unsigned h;
+
+  orig_heads_size = 1;
+  while (orig_heads_size < 2 * orig_clauses) orig_heads_size *= 2;
+  NEWN (orig_heads, orig_heads_size);
+  NEWN (orig_next, orig_clauses + 1);
+  orig_stamp_size = num_vars + 1;
+  NEWN (orig_stamp, orig_stamp_size);
+
+  for (i = 1; i <= orig_clauses; i++) {
+    Clause *c = clauses + i - 1;
+    for (h = 0, j = 0; j < c->size; j++)
+      if (!is_universal (c->lits[j])) h += hash_lit (c->lits[j]);
+    h &= orig_heads_size - 1;
+    orig_next [i] = orig_heads [h];
+    orig_heads [h] = i;
+  }
+}
+
+static void release_orig_index () {
+  free (orig_heads);
+  free (orig_next);
+  free (orig_stamp);
+  orig_heads = orig_next = orig_stamp = NULL;
+}
+
+/* Returns the (1-based) index of an original clause whose existential
+ * literals are exactly those of the leaf and whose universal literals are
+ * not satisfied by the annotations of the leaf. */
+static int find_orig_clause (P_Clause *c) {
+  int i, j, k, lit, num_ex = 0, match;
+  unsigned h = 0;
+
+  orig_stamp_gen += 2;
+  for (i = 0; i < c->size; i++) {
+    lit = plit2olit (c->nodes[i]);
+    if (orig_stamp [abs(lit)] < orig_stamp_gen) {
+      orig_stamp [abs(lit)] = orig_stamp_gen + (lit < 0);
+      h += hash_lit (lit);
+      num_ex++;
+    }
+    for (j = 0; j < a_vars [abs(c->nodes[i])].ann_size; j++) {
+      lit = a_vars [abs(c->nodes[i])].u_annotations [j];
+      orig_stamp [abs(lit)] = orig_stamp_gen + (lit < 0);
+    }
+  }
+
+  for (i = orig_heads [h & (orig_heads_size - 1)]; i; i = orig_next [i]) {
+    Clause *oc = clauses + i - 1;
+    match = 1;
+    for (k = j = 0; match && j < oc->size; j++) {
+      lit = oc->lits[j];
+      if (orig_stamp [abs(lit)] < orig_stamp_gen) {
+        if (!is_universal (lit)) match = 0;
+      } else if (is_universal (lit)) {
+        if (orig_stamp [abs(lit)] == orig_stamp_gen + (lit < 0)) match = 0;
+      } else if (orig_stamp [abs(lit)] == orig_stamp_gen + (lit < 0)) {
+        k++;
+      } else match = 0;
+    }
+    if (match && k == num_ex) return i;
+  }
+  return 0;
+}
+
+/* Resolution chains of extended traces (picosat -T) list the antecedents
+ * of a clause in arbitrary order. As in tracecheck, they are ordered by unit
+ * propagation on the negation of the clause. The antecedent that becomes
+ * falsified starts the chain, which continues with the reasons of its false
+ * literals in reverse propagation order. A RUP step of LRAT only has to
+ * contain this resolvent, so a proper subset replaces the literals of the
+ * clause. Returns the length of the chain, 0 if it does not derive a subset
+ * of the clause. */
+
+static TLS int *ants, *ant_units, *ant_trail, num_ants, ants_size;
+static TLS int *aliases, aliases_size;   // clauses replaced by an antecedent
+
+static int order_chain (int cl) {
+  P_Clause *c, *res = p_clauses + cl;
+  int i, j, k, n, lit, unit = 0, sat, open, conflict = -1, trail = 0;
+  int progress = 1, in = 0;
+
+  // Mark holds the false literal of each assigned variable
+  assert (!num_lits);
+  for (j = 0; j < res->size; j++) {
+    a_vars [abs(res->nodes[j])].mark = res->nodes[j];
+    push_literal (res->nodes[j]);
+  }
+  memset (ant_units, 0, num_ants * sizeof *ant_units);
+
+  while (conflict < 0 && progress) {
+    progress = 0;
+    for (i = 0; conflict < 0 && i < num_ants; i++) {
+      if (ant_units [i]) continue;
+      c = p_clauses + ants [i];
+      for (sat = open = j = 0; !sat && j < c->size; j++) {
+        lit = c->nodes[j];
+        if (a_vars [abs(lit)].mark == -lit) sat = 1;
+        else if (!a_vars [abs(lit)].mark) {
+          unit = lit;
+          open++;
+        }
+      }
+      if (sat || open > 1) continue;
+      if (!open) {
+        conflict = i;
+        continue;
+      }
+      a_vars [abs(unit)].mark = -unit;
+      push_literal (unit);
+      ant_units [i] = unit;
+      ant_trail [trail++] = i;
+      progress = 1;
+    }
+  }
+
+  for (j = 0; j < num_lits; j++) a_vars [abs(lits[j])].mark = 0;
+  num_lits = 0;
+  if (conflict < 0) return 0;
+
+  // Mark now holds the literals of the resolvent
+  n = 0;
+  res->chain [n++] = ants [conflict];
+  c = p_clauses + ants [conflict];
+  for (j = 0; j < c->size; j++) {
+    a_vars [abs(c->nodes[j])].mark = c->nodes[j];
+    push_literal (c->nodes[j]);
+  }
+
+  for (i = trail - 1; i >= 0; i--) {
+    unit = ant_units [ant_trail [i]];
+    if (a_vars [abs(unit)].mark != -unit) continue;
+    res->pivots [n - 1] = -unit;
+    res->chain [n++] = ants [ant_trail [i]];
+    a_vars [abs(unit)].mark = 0;
+    c = p_clauses + ants [ant_trail [i]];
+    for (j = 0; j < c->size; j++) {
+      lit = c->nodes[j];
+      if (lit == unit || a_vars [abs(lit)].mark) continue;
+      a_vars [abs(lit)].mark = lit;
+      push_literal (lit);
+    }
+  }
+  res->chain_size = n;
+
+  for (j = 0; j < res->size; j++)
+    if (a_vars [abs(res->nodes[j])].mark == res->nodes[j]) in++;
+  for (j = k = 0; j < num_lits; j++) {
+    lit = lits[j];
+    if (!a_vars [abs(lit)].mark) continue;
+    a_vars [abs(lit)].mark = 0;
+    lits [k++] = lit;
+  }
+  num_lits = 0;
+  if (in != k) return 0;
+
+  if (k < res->size) {
+    memcpy (res->nodes, lits, sizeof (int) * k);
+    qsort (res->nodes, k, sizeof (int), cmpfunc);
+    res->size = k;
+  }
+  return n;
+}
+
+// Refers to 'ant' wherever a later clause names 'cl'
+static void set_alias (int cl, int ant) {
+  P_Clause *c = p_clauses + cl;
+
+  if (aliases_size <= cl) {
+    RSZ (aliases, aliases_size, grown_size (aliases_size, cl));
+    aliases_size = grown_size (aliases_size, cl);
+  }
+  aliases [cl] = ant;
+  free (c->nodes);
+  free (c->chain);
+  free (c->pivots);
+  memset (c, 0, sizeof *c);
+}
+
+static void push_ant (int ant) {
+  if (num_ants == ants_size) {
+    RSZ (ants, ants_size, 2*ants_size + 2);
+    RSZ (ant_units, ants_size, 2*ants_size + 2);
+    RSZ (ant_trail, ants_size, 2*ants_size + 2);
+    ants_size = 2*ants_size + 2;
+  }
+  ants [num_ants++] = ant;
+}
+
+static void release_ants () {
+  free (ants);
+  free (ant_units);
+  free (ant_trail);
+  free (aliases);
+  ants = ant_units = ant_trail = aliases = NULL;
+  ants_size = num_ants = aliases_size = 0;
+}
+
+/* Adds clause 'cl' with the literals in 'lits' derived from the antecedents
+ * in 'ants', or a leaf if there are none. A clause that only weakens one
+ * antecedent is not added; later clauses use the antecedent instead. */
+static void add_trace_clause (int cl) {
+  int i, n, *lts;
+
+  if (cl <= 0) die ("error in parsing trace (neg clause idx)");
+  if (p_clauses_size <= cl) enlarge_proof_clauses (cl);
+  if (p_clauses [cl].name || (cl < aliases_size && aliases [cl]))
+    die ("clause init twice");
+  p_clauses [cl].name = cl;
+
+  for (i = 0; i < num_lits; i++)
+    if (abs(lits[i]) >= a_vars_size || !a_vars [abs(lits[i])].orig_ex_name)
+      die ("unknown expansion variable %d in clause %d", lits[i], cl);
+  lts = malloc (sizeof (int) * num_lits);
+  for (i = 0; i < num_lits; i++) lts [i] = lits[i];
+  qsort (lts, num_lits, sizeof (int), cmpfunc);
+  p_clauses [cl].size = num_lits;
+  p_clauses [cl].nodes = lts;
+  num_lits = 0;
+
+  for (i = 0; i < num_ants; i++) {
+    if (ants [i] > 0 && ants [i] < aliases_size && aliases [ants [i]])
+      ants [i] = aliases [ants [i]];
+    if (ants [i] <= 0 || ants [i] >= cl || !p_clauses [ants [i]].name)
+      die ("invalid antecedent %d of clause %d", ants [i], cl);
+  }
+
+  if (num_ants) {
+    NEWN (p_clauses[cl].chain, num_ants);
+    NEWN (p_clauses[cl].pivots, num_ants);
+    if (!(n = order_chain (cl)))
+      die ("antecedents of clause %d do not form a resolution chain", cl);
+    p_clauses[cl].p1 = p_clauses[cl].chain[0];
+    if (n == 1) {
+      set_alias (cl, p_clauses[cl].p1);
+      num_ants = 0;
+      return;
+    }
+    p_clauses[cl].p2 = p_clauses[cl].chain[1];
+    p_clauses[cl].pivot = p_clauses[cl].pivots[0];
+    if (n == 2) {
+      // A single resolution needs no chain
+      free (p_clauses[cl].chain);
+      free (p_clauses[cl].pivots);
+      p_clauses[cl].chain = p_clauses[cl].pivots = NULL;
+      p_clauses[cl].chain_size = 0;
+    }
+  } else {
+    p_clauses[cl].p1 = find_orig_clause (p_clauses + cl);
+    if (!p_clauses[cl].p1)
+      die ("clause %d is not an instance of an original clause", cl);
+    p_clauses[cl].p2 = 0;
+    if (check_proof) check_leaf (cl);
+  }
+  if (!p_clauses [cl].size) p_empty_clause = cl;
+  num_ants = 0;
+}
+
+/* Reads the expansion variables from the comments of the expanded CNF. If
+ * 'leaves' is set, its clauses are also added as leaves 1, 2, ... of the
+ * proof, which is how LRAT proofs refer to them. */
+int parse_expansion (FILE *f, int leaves) {
+  int ch, lit, cl = 0;
+
+  num_p_vars = 1;
+  num_p_clauses = 1;
+  if (leaves) init_orig_index ();
+
+  assert (!num_lits);
+  for (;;) {
+    ch = getc (f);
+    if (ch == EOF) break;
+    if (ch == 'c') {
+      while ((ch = getc (f)) == ' ' || ch == '\t')
+        ;
+      if (ch == 'x') {
+        if (fscanf (f, "%d", &lit) != 1) die ("error in parsing expansion");
+        parse_expansion_vars (f, lit);
+        num_lits = 0;
+      }
+    } else if (leaves && ch != 'p' && !isspace (ch)) {
+      ungetc (ch, f);
+      while (fscanf (f, "%d", &lit) == 1 && lit) push_literal (lit);
+      if (lit) die ("error in parsing clause %d of CNF", cl + 1);
+      add_trace_clause (++cl);
+    }
+    while (ch != '\n' && ch != EOF) ch = getc (f);
+    if (ch == EOF) break;
+  }
+
+  if (leaves) release_orig_index ();
+  return 0;
+}
+
+int parse_trace (FILE *f) {
+  int tmp, cl, lit;
+
+  init_orig_index ();
+
+  assert (!num_lits);
+  do {
+    tmp = fscanf (f, "%d", &cl);
+    if (tmp == EOF) break;
+    if (tmp <= 0) die ("error in parsing trace");
+
+    for (;;) {
+      tmp = fscanf (f, "%d", &lit);
+      if (tmp <= 0) die ("error in parsing trace");
+      if (!lit) break;
+      push_literal (lit);
+    }
+    for (;;) {
+      tmp = fscanf (f, "%d", &lit);
+      if (tmp <= 0) die ("error in parsing trace");
+      if (!lit) break;
+      push_ant (lit);
+    }
+    add_trace_clause (cl);
+  } while (!p_empty_clause);
+
+  if (!p_empty_clause) die ("trace does not derive the empty clause");
+  num_p_clauses = p_empty_clause + 1;
+  release_orig_index ();
+  release_ants ();
+
+  return 0;
+}
+
+/* LRAT proofs (text format) of the expanded CNF, as written by CaDiCaL with
+ * --lrat --no-binary. The hints of each clause are exactly the antecedents
+ * of a resolution chain in propagation order, so they need no search. */
+int parse_lrat (FILE *f) {
+  int tmp, ch, cl, lit;
+
+  assert (!num_lits);
+  do {
+    tmp = fscanf (f, "%d", &cl);
+    if (tmp == EOF) break;
+    if (tmp <= 0) die ("error in parsing LRAT proof");
+
+    while ((ch = getc (f)) == ' ' || ch == '\t')
+      ;
+    if (ch == 'd') {
+      while ((tmp = fscanf (f, "%d", &lit)) == 1 && lit)
+        ;
+      if (tmp <= 0) die ("error in parsing LRAT proof");
+      continue;
+    }
+    ungetc (ch, f);
+
+    for (;;) {
+      tmp = fscanf (f, "%d", &lit);
+      if (tmp <= 0) die ("error in parsing LRAT proof");
+      if (!lit) break;
+      push_literal (lit);
+    }
+    for (;;) {
+      tmp = fscanf (f, "%d", &lit);
+      if (tmp <= 0) die ("error in parsing LRAT proof");
+      if (!lit) break;
+      if (lit < 0) die ("RAT step in clause %d not supported", cl);
+      push_ant (lit);
+    }
+    add_trace_clause (cl);
+  } while (!p_empty_clause);
+
+  if (!p_empty_clause) die ("LRAT proof does not derive the empty clause");
+  num_p_clauses = p_empty_clause + 1;
+  release_ants ();
+
+  return 0;
+}
+
+/* Marks the clauses the empty clause depends on by counting their uses,
+ * and releases all other clauses. The empty clause counts as used once.
+ * Returns the number of clauses left. */
+int trim_proof () {
+  P_Clause *c;
+  int i, j, live = 0;
+
+  for (i = 0; i < num_p_clauses; i++) p_clauses [i].uses = 0;
+  p_clauses [p_empty_clause].uses = 1;
+  for (i = p_empty_clause; i > 0; i--) {
+    c = p_clauses + i;
+    if (!c->name) continue;
+    if (!c->uses) {
+      free (c->nodes);
+      free (c->chain);
+      free (c->pivots);
+      memset (c, 0, sizeof *c);
+      continue;
+    }
+    live++;
+    if (!c->p2) continue;
+    if (c->chain) {
+      for (j = 0; j < c->chain_size; j++) p_clauses [c->chain[j]].uses++;
+    } else {
+      p_clauses [c->p1].uses++;
+      p_clauses [c->p2].uses++;
+    }
+  }
+  return live;
+}
+
 void print_proof () {
   int i, j;
   P_Clause *c;  
@@ -267,3 +859,27 @@ void print_proof () {
     printf ("\n"); 
   } 
 }
+
+void proof_state (Visit visit) {
+  VISIT (a_vars_size);
+  VISIT (p_clauses_size);
+  VISIT (a_vars);
+  VISIT (p_clauses);
+  VISIT (p_empty_clause);
+  VISIT (num_p_vars);
+  VISIT (num_p_clauses);
+  VISIT (check_proof);
+  VISIT (orig_heads);
+  VISIT (orig_next);
+  VISIT (orig_heads_size);
+  VISIT (orig_stamp);
+  VISIT (orig_stamp_size);
+  VISIT (orig_stamp_gen);
+  VISIT (ants);
+  VISIT (ant_units);
+  VISIT (ant_trail);
+  VISIT (num_ants);
+  VISIT (ants_size);
+  VISIT (aliases);
+  VISIT (aliases_size);
+}
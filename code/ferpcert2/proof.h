@@ -1,6 +1,8 @@
 #ifndef PROOF_H
 #define PROOF_H
 
+#include "admin.h"
+
 typedef struct A_Var A_Var;
 typedef struct P_Clause P_Clause;
 
@@ -20,16 +22,23 @@ struct P_Clause {
   int p1, p2; 		// parent clauses
   int size;		// number of nodes
   int *nodes;  		// literals of clause
+  int uset;        // interned set of the universals (uset.c)
   int *universals; // universal variables with non-trivial partial functions
   int *aig_labels; // aig labels for partial functions
   int num_universals;
+  int chain_size;  // number of antecedents of a resolution chain
+  int *chain;      // antecedents in resolution order (chains only)
+  int *pivots;     // pivot of each step, occurring in the left clause
+  int uses;        // live children whose labels are not yet computed
+  int leaf_label;  // labels shared with other leaves (extract.c), 0 if none
 };
 
-extern int a_vars_size, p_clauses_size;
-extern A_Var *a_vars;
-extern P_Clause *p_clauses;
-extern int p_empty_clause;
-extern int num_p_vars, num_p_clauses;
+extern TLS int a_vars_size, p_clauses_size;
+extern TLS A_Var *a_vars;
+extern TLS P_Clause *p_clauses;
+extern TLS int p_empty_clause;
+extern TLS int num_p_vars, num_p_clauses;
+extern TLS int check_proof;
 
 int a_lit2var (int); 
 int avar_get_level (int); 
@@ -37,7 +46,12 @@ void proof_release ();
 void enlarge_proof_vars (int);
 void enlarge_proof_clauses (int);
 int parse_proof (FILE *); 
+int parse_expansion (FILE *, int);
+int parse_trace (FILE *);
+int parse_lrat (FILE *);
+int trim_proof ();
 void print_proof (); 
 int get_max_exists_level (P_Clause *); 
 void print_p_clause (P_Clause *);
+void proof_state (Visit);
 #endif
@@ -0,0 +1,260 @@
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "admin.h"
+#include "libferpcert.h"
+#include "serve.h"
+
+/* ferpcert --serve=<socket>: certification jobs over a local UNIX socket.
+ * A client sends one job per line,
+ *   [ --compress ] [ --minimize=<sec> ] [ --binary ]
+ *   [ --qbf-size=<n> ] [ --proof-size=<n> ] <qbf> <proof> <aig>
+ * and reads one line of JSON per job, in order. Proofs are always checked:
+ * the parsers die() on malformed input, which fails only the job, while
+ * extraction asserts that the proof is valid, and a failed assertion would
+ * end all jobs. A <qbf> or <proof> of '-' is sent after the line as <n>
+ * bytes, the QBF first; an <aig> of '-' is
+ * returned in the result as ASCII AIGER. Paths are relative to the working
+ * directory of the server. A pool of worker threads serves the connections,
+ * each worker one connection at a time; workers live as long as the server,
+ * so the allocator arenas of a thread are reused by all its jobs. */
+
+#define QUEUE_SIZE 256
+#define MAX_SIZE (1L << 34)
+
+static struct {
+  int fds [QUEUE_SIZE];
+  int head, count;
+  pthread_mutex_t lock;
+  pthread_cond_t ready, space;
+} queue = { .lock = PTHREAD_MUTEX_INITIALIZER,
+            .ready = PTHREAD_COND_INITIALIZER,
+            .space = PTHREAD_COND_INITIALIZER };
+
+static volatile sig_atomic_t stop;
+
+static void on_signal (int sig) {
+  stop = 1;
+}
+
+static double now () {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void json_string (FILE *out, const char *s, size_t n) {
+  size_t i;
+
+  fputc ('"', out);
+  for (i = 0; i < n; i++) {
+    unsigned char c = s [i];
+    if (c == '"' || c == '\\') fprintf (out, "\\%c", c);
+    else if (c == '\n') fputs ("\\n", out);
+    else if (c < 0x20) fprintf (out, "\\u%04x", c);
+    else fputc (c, out);
+  }
+  fputc ('"', out);
+}
+
+// Reads 'size' bytes following the job line, NULL if the stream ends first
+static char * read_input (FILE *in, long size) {
+  char *buffer = malloc (size ? size : 1);
+
+  if (buffer && fread (buffer, 1, size, in) == (size_t) size) return buffer;
+  free (buffer);
+  return NULL;
+}
+
+static int read_file (ferpcert *ctx, int proof, const char *path, char *buffer, long size) {
+  if (buffer)
+    return proof ? ferpcert_read_proof_buffer (ctx, buffer, size)
+                 : ferpcert_read_qbf_buffer (ctx, buffer, size);
+  return proof ? ferpcert_read_proof (ctx, path) : ferpcert_read_qbf (ctx, path);
+}
+
+// Runs the job on 'line' and writes its result; returns 0 if the
+// connection is out of sync and has to be closed
+static int run_job (char *line, FILE *in, FILE *out) {
+  char *files [3], *buffers [2] = { NULL, NULL }, *token, *save, *text = NULL;
+  const char *err = NULL;
+  char msg [300];
+  long sizes [2] = { -1, -1 };
+  int i, num_files = 0, compress = 0, binary = 0, sync = 1;
+  double minimize = -1, start = now ();
+  ferpcert *ctx = NULL;
+  simpleaig *aig = NULL;
+  size_t text_size = 0;
+  FILE *f;
+
+  for (token = strtok_r (line, " \t\r\n", &save); token;
+       token = strtok_r (NULL, " \t\r\n", &save)) {
+    if (!strcmp (token, "--compress")) compress = 1;
+    else if (!strcmp (token, "--binary")) binary = 1;
+    else if (!strncmp (token, "--minimize=", 11)) {
+      if ((minimize = atof (token + 11)) < 0) err = "invalid time limit";
+    }
+    else if (!strncmp (token, "--qbf-size=", 11)) sizes [0] = atol (token + 11);
+    else if (!strncmp (token, "--proof-size=", 13)) sizes [1] = atol (token + 13);
+    else if (token [0] == '-' && token [1]) {
+      if (!err) snprintf (msg, sizeof msg, "invalid option '%.256s'", token);
+      err = msg;
+    } else if (num_files < 3) files [num_files++] = token;
+    else err = "invalid number of arguments";
+  }
+  if (!num_files && !err) return 1;   // empty line
+
+  // The stream inputs are read even for an invalid job to stay in sync
+  for (i = 0; i < 2; i++) {
+    if (sizes [i] < 0) continue;
+    if (sizes [i] > MAX_SIZE || !(buffers [i] = read_input (in, sizes [i]))) {
+      err = "could not read stream input";
+      sync = 0;
+      break;
+    }
+  }
+  if (!err && num_files != 3) err = "invalid number of arguments";
+  for (i = 0; !err && i < 2; i++)
+    if (!strcmp (files [i], "-") != (buffers [i] != NULL))
+      err = buffers [i] ? "a size is only valid for '-'" : "'-' requires a size";
+  if (!err && !(ctx = ferpcert_new ())) err = "out of memory";
+  if (!err) {
+    ferpcert_set_option (ctx, "check", 1);
+    ferpcert_set_option (ctx, "compress", compress);
+    ferpcert_set_option (ctx, "minimize", minimize);
+    if (read_file (ctx, 0, files [0], buffers [0], sizes [0]) ||
+        read_file (ctx, 1, files [1], buffers [1], sizes [1]) ||
+        !(aig = ferpcert_extract (ctx)))
+      err = ferpcert_error (ctx);
+  }
+  if (!err) {
+    if (!strcmp (files [2], "-")) f = open_memstream (&text, &text_size);
+    else f = fopen (files [2], "w");
+    if (f) {
+      simpleaig_write_aiger_to_file (aig, f, binary && !text);
+      if (fclose (f) && !text) err = "could not write AIG";
+    } else {
+      snprintf (msg, sizeof msg, "could not write AIG %.256s", files [2]);
+      err = msg;
+    }
+  }
+
+  if (err) {
+    fprintf (out, "{\"status\": \"error\", \"error\": ");
+    json_string (out, err, strlen (err));
+  } else {
+    fprintf (out, "{\"status\": \"ok\", \"inputs\": %u, \"outputs\": %u, \"gates\": %u",
+             aig->num_inputs, aig->num_outputs, aig->num_ands);
+    if (text) {
+      fprintf (out, ", \"aig\": ");
+      json_string (out, text, text_size);
+    }
+  }
+  fprintf (out, ", \"seconds\": %.6f}\n", now () - start);
+  fflush (out);
+
+  if (aig) simpleaig_reset (aig);
+  ferpcert_delete (ctx);
+  free (text);
+  free (buffers [0]);
+  free (buffers [1]);
+  return sync;
+}
+
+static void serve_connection (int fd) {
+  FILE *in = fdopen (fd, "r"), *out = NULL;
+  char *line = NULL;
+  size_t size = 0;
+  int out_fd = dup (fd);
+
+  if (out_fd >= 0 && !(out = fdopen (out_fd, "w"))) close (out_fd);
+  if (in && out)
+    while (getline (&line, &size, in) > 0 && run_job (line, in, out))
+      ;
+  free (line);
+  if (out) fclose (out);
+  if (in) fclose (in);
+  else close (fd);
+}
+
+static void * worker (void *arg) {
+  int fd;
+
+  for (;;) {
+    pthread_mutex_lock (&queue.lock);
+    while (!queue.count) pthread_cond_wait (&queue.ready, &queue.lock);
+    fd = queue.fds [queue.head];
+    queue.head = (queue.head + 1) % QUEUE_SIZE;
+    queue.count--;
+    pthread_cond_signal (&queue.space);
+    pthread_mutex_unlock (&queue.lock);
+    serve_connection (fd);
+  }
+  return NULL;
+}
+
+static void push (int fd) {
+  pthread_mutex_lock (&queue.lock);
+  while (queue.count == QUEUE_SIZE) pthread_cond_wait (&queue.space, &queue.lock);
+  queue.fds [(queue.head + queue.count++) % QUEUE_SIZE] = fd;
+  pthread_cond_signal (&queue.ready);
+  pthread_mutex_unlock (&queue.lock);
+}
+
+// Serves jobs on the socket at 'path' until SIGINT or SIGTERM
+int serve (const char *path, int workers) {
+  struct sockaddr_un addr;
+  struct sigaction action;
+  struct stat st;
+  sigset_t signals, old;
+  pthread_t thread;
+  int i, fd, listen_fd;
+
+  if (strlen (path) >= sizeof addr.sun_path) die ("socket path too long '%s'", path);
+  if (workers <= 0 && (workers = sysconf (_SC_NPROCESSORS_ONLN)) <= 0) workers = 1;
+  memset (&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, path);
+  // A socket left behind by an earlier server is replaced
+  if (!stat (path, &st) && S_ISSOCK (st.st_mode)) unlink (path);
+  if ((listen_fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+      bind (listen_fd, (struct sockaddr *) &addr, sizeof addr) ||
+      listen (listen_fd, SOMAXCONN))
+    die ("could not listen on %s: %s", path, strerror (errno));
+
+  signal (SIGPIPE, SIG_IGN);
+  memset (&action, 0, sizeof action);
+  action.sa_handler = on_signal;   // no SA_RESTART, accept returns on a signal
+  sigaction (SIGINT, &action, NULL);
+  sigaction (SIGTERM, &action, NULL);
+
+  // Only the accepting thread takes the signals
+  sigemptyset (&signals);
+  sigaddset (&signals, SIGINT);
+  sigaddset (&signals, SIGTERM);
+  pthread_sigmask (SIG_BLOCK, &signals, &old);
+  for (i = 0; i < workers; i++) {
+    if (pthread_create (&thread, NULL, worker, NULL)) die ("could not start workers");
+    pthread_detach (thread);
+  }
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+
+  fprintf (stderr, "serving on %s with %d workers\n", path, workers);
+  while (!stop) {
+    if ((fd = accept (listen_fd, NULL, NULL)) >= 0) push (fd);
+    else if (errno != EINTR && errno != ECONNABORTED)
+      die ("could not accept on %s: %s", path, strerror (errno));
+  }
+  close (listen_fd);
+  unlink (path);
+  return 0;
+}
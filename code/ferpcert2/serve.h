@@ -0,0 +1,6 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+int serve (const char *, int);
+
+#endif
@@ -87,10 +87,11 @@ struct bucket
   unsigned *collisions;
 };
 
-static char *in_mmap = NULL;
-static size_t in_mmap_size = 0;
-static unsigned long in_mmap_pos = 0;
-static int (*_getc)(void) = NULL;
+/* reader state, thread-local so that threads may read concurrently  */
+static __thread char *in_mmap = NULL;
+static __thread size_t in_mmap_size = 0;
+static __thread unsigned long in_mmap_pos = 0;
+static __thread int (*_getc)(void) = NULL;
 
 simpleaig *
 simpleaig_init (void)
@@ -721,6 +722,7 @@ simpleaig_read_aiger_from_file (simpleaig *aig, char *filename, char hashing)
     in_mmap = (char *) mmap (0, in_mmap_size, PROT_READ, 
                              MAP_PRIVATE | MAP_NORESERVE, in_mmap_fd, 0);
     PARSER_ABORT (in_mmap == MAP_FAILED, "failed to mmap aiger file");
+    in_mmap_pos = 0;
     close (in_mmap_fd);
 
     _getc = mmap_getc;
@@ -764,6 +766,7 @@ simpleaig_read_aiger_from_file (simpleaig *aig, char *filename, char hashing)
 
   if (in_mmap != NULL)
     munmap (in_mmap, in_mmap_size);
+  in_mmap = NULL;
 
   return error;
 }
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "stats.h"
+
+/* Per-phase timing and memory use (--stats=json). Counters are always
+ * updated, phases are only timed if statistics were requested. The peak
+ * RSS of a phase is the peak of the process at its end. */
+
+TLS int stats;
+TLS long long counters [NUM_COUNTERS];
+TLS double progress;        // seconds between progress lines, 0 if off
+TLS char *progress_file;    // replaced by each progress line instead of stderr
+
+static const char *phase_names [NUM_PHASES] = {
+  "parse_qbf", "parse_proof", "compress", "extract", "cones", "minimize",
+  "write"
+};
+
+static const char *counter_names [NUM_COUNTERS] = {
+  "proof_clauses", "live_clauses", "leaves", "resolutions", "gates_created",
+  "gates_shared", "output_gates"
+};
+
+static TLS struct {
+  int ran;
+  double wall, cpu, wall_start, cpu_start;
+  long max_rss;
+} phases [NUM_PHASES];
+
+static TLS double progress_last;
+static TLS int progress_done;
+
+static double wall_time () {
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+void stats_begin (Phase p) {
+  if (!stats) return;
+  phases [p].wall_start = wall_time ();
+  phases [p].cpu_start = (double) clock () / CLOCKS_PER_SEC;
+}
+
+void stats_end (Phase p) {
+  struct rusage usage;
+
+  if (!stats) return;
+  phases [p].ran = 1;
+  phases [p].wall += wall_time () - phases [p].wall_start;
+  phases [p].cpu += (double) clock () / CLOCKS_PER_SEC - phases [p].cpu_start;
+  getrusage (RUSAGE_SELF, &usage);
+  phases [p].max_rss = usage.ru_maxrss;
+}
+
+void stats_print_json (FILE *out) {
+  int i, first = 1;
+
+  fprintf (out, "{\"phases\": {");
+  for (i = 0; i < NUM_PHASES; i++) {
+    if (!phases [i].ran) continue;
+    fprintf (out, "%s\"%s\": {\"wall\": %.6f, \"cpu\": %.6f, \"max_rss_kb\": %ld}",
+             first ? "" : ", ", phase_names [i], phases [i].wall, phases [i].cpu,
+             phases [i].max_rss);
+    first = 0;
+  }
+  fprintf (out, "}, \"counters\": {");
+  for (i = 0; i < NUM_COUNTERS; i++)
+    fprintf (out, "%s\"%s\": %lld", i ? ", " : "", counter_names [i], counters [i]);
+  fprintf (out, "}}\n");
+}
+
+/* Progress of the interpolant loop (--progress). The loop asks for a line
+ * every 1024 clauses, and lines are written at most every 'progress'
+ * seconds. Rate and eta are those since the previous line, as the cost of
+ * a clause changes over the proof. */
+
+void progress_begin (int first) {
+  progress_last = wall_time ();
+  progress_done = first;
+}
+
+int progress_due () {
+  return wall_time () - progress_last >= progress;
+}
+
+// Current RSS in KB, or the peak if it is not available
+static long rss () {
+  struct rusage usage;
+  long pages;
+  FILE *f = fopen ("/proc/self/statm", "r");
+
+  if (f) {
+    int ok = fscanf (f, "%*d %ld", &pages) == 1;
+    fclose (f);
+    if (ok) return pages * (sysconf (_SC_PAGESIZE) / 1024);
+  }
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+void progress_report (int done, int total, unsigned gates, double load) {
+  double now = wall_time (), rate;
+  char *tmp;
+  FILE *out = stderr;
+
+  rate = now > progress_last ? (done - progress_done) / (now - progress_last) : 0;
+  progress_last = now;
+  progress_done = done;
+  if (progress_file) {
+    tmp = malloc (strlen (progress_file) + 5);
+    sprintf (tmp, "%s.tmp", progress_file);
+    if (!(out = fopen (tmp, "w"))) {
+      free (tmp);
+      return;
+    }
+  }
+  fprintf (out, "progress: %d/%d clauses (%.1f%%), %.0f clauses/s, %u gates, "
+           "load %.2f, rss %ld MB, eta ", done, total, 100.0 * done / total,
+           rate, gates, load, rss () / 1024);
+  if (rate > 0) fprintf (out, "%.0f s\n", (total - done) / rate);
+  else fprintf (out, "unknown\n");
+  if (progress_file) {
+    fclose (out);
+    rename (tmp, progress_file);
+    free (tmp);
+  }
+}
+
+void stats_state (Visit visit) {
+  VISIT (stats);
+  VISIT (counters);
+  VISIT (progress);
+  VISIT (progress_file);
+  VISIT (phases);
+  VISIT (progress_last);
+  VISIT (progress_done);
+}
@@ -0,0 +1,43 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#include "admin.h"
+
+typedef enum {
+  PHASE_PARSE_QBF,
+  PHASE_PARSE_PROOF,
+  PHASE_COMPRESS,
+  PHASE_EXTRACT,
+  PHASE_CONES,
+  PHASE_MINIMIZE,
+  PHASE_WRITE,
+  NUM_PHASES
+} Phase;
+
+typedef enum {
+  COUNT_PROOF_CLAUSES,
+  COUNT_LIVE_CLAUSES,
+  COUNT_LEAVES,
+  COUNT_RESOLUTIONS,
+  COUNT_GATES_CREATED,
+  COUNT_GATES_SHARED,
+  COUNT_OUTPUT_GATES,
+  NUM_COUNTERS
+} Counter;
+
+extern TLS int stats;
+extern TLS long long counters [NUM_COUNTERS];
+extern TLS double progress;
+extern TLS char *progress_file;
+
+void stats_begin (Phase);
+void stats_end (Phase);
+void stats_print_json (FILE *);
+void progress_begin (int);
+int progress_due ();
+void progress_report (int, int, unsigned, double);
+void stats_state (Visit);
+
+#endif
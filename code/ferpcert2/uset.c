@@ -0,0 +1,165 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "admin.h"
+#include "uset.h"
+
+/* Hash-consed sets of universal variables for the labels of extract.c.
+ * Equal sets share one reference counted copy, and unions of two sets are
+ * remembered in a direct mapped cache. Set 0 is the empty set. Released
+ * slots are reused; cache entries keep the stamps of their sets, so an
+ * entry naming a released or reused slot just misses. */
+
+typedef struct Union {
+  unsigned a, b, res;  // stamps
+  int id;              // of the result
+} Union;
+
+TLS USet *usets;
+static TLS int num_usets, size_usets, free_usets;
+static TLS unsigned stamp;
+static TLS int *order;
+static TLS int *buckets;
+static TLS Union *unions;
+static TLS unsigned buckets_size;
+
+static unsigned hash_vars (int *vars, int size) {
+  unsigned h = 0;
+  int i;
+  for (i = 0; i < size; i++) h = (h * 17) ^ vars[i];
+  return h;
+}
+
+void uset_init (int *var_order, unsigned size) {
+  order = var_order;
+  buckets_size = 1;
+  while (buckets_size < size) buckets_size <<= 1;
+  NEWN (buckets, buckets_size);
+  NEWN (unions, buckets_size);
+  size_usets = 1024;
+  NEWN (usets, size_usets);
+  num_usets = 1;
+  free_usets = 0;
+  stamp = 0;
+  usets [0].refs = 1;
+}
+
+void uset_reset () {
+  int i;
+  for (i = 1; i < num_usets; i++) free (usets [i].vars);
+  free (usets);
+  free (buckets);
+  free (unions);
+  usets = NULL;
+  buckets = NULL;
+  unions = NULL;
+  num_usets = size_usets = free_usets = 0;
+}
+
+void uset_ref (int s) {
+  assert (usets [s].refs > 0);
+  usets [s].refs++;
+}
+
+void uset_release (int s) {
+  int *p;
+  if (!s || --usets [s].refs) return;
+  p = buckets + (usets [s].hash & (buckets_size - 1));
+  while (*p != s) p = &usets [*p].next;
+  *p = usets [s].next;
+  free (usets [s].vars);
+  usets [s].vars = NULL;
+  usets [s].next = free_usets;
+  free_usets = s;
+}
+
+// Returns the set of the 'size' variables in 'vars', with a new reference
+int uset_intern (int *vars, int size) {
+  unsigned h;
+  int s, i;
+
+  if (!size) return 0;
+  h = hash_vars (vars, size);
+  for (s = buckets [h & (buckets_size - 1)]; s; s = usets [s].next) {
+    if (usets [s].hash != h || usets [s].size != size) continue;
+    for (i = 0; i < size && usets [s].vars[i] == vars[i]; i++);
+    if (i == size) {
+      usets [s].refs++;
+      return s;
+    }
+  }
+  if (free_usets) {
+    s = free_usets;
+    free_usets = usets [s].next;
+  } else {
+    if (num_usets == size_usets) {
+      RSZ (usets, size_usets, 2 * size_usets);
+      size_usets *= 2;
+    }
+    s = num_usets++;
+  }
+  usets [s].size = size;
+  usets [s].vars = malloc (sizeof (int) * size);
+  memcpy (usets [s].vars, vars, sizeof (int) * size);
+  usets [s].refs = 1;
+  usets [s].hash = h;
+  usets [s].stamp = ++stamp;
+  usets [s].next = buckets [h & (buckets_size - 1)];
+  buckets [h & (buckets_size - 1)] = s;
+  return s;
+}
+
+// Returns the union of two sets, with a new reference
+int uset_union (int a, int b) {
+  USet *x, *y;
+  Union *u;
+  int i, j, k, s, *vars;
+
+  if (a > b) { s = a; a = b; b = s; }
+  if (!a || a == b) {
+    uset_ref (b);
+    return b;
+  }
+  u = unions + (((unsigned) a * 17 ^ b) & (buckets_size - 1));
+  if (u->a == usets [a].stamp && u->b == usets [b].stamp &&
+      u->res == usets [u->id].stamp && usets [u->id].refs) {
+    usets [u->id].refs++;
+    return u->id;
+  }
+
+  x = usets + a;
+  y = usets + b;
+  vars = malloc (sizeof (int) * (x->size + y->size));
+  for (i = j = k = 0; i < x->size || j < y->size; ) {
+    if (j == y->size ||
+        (i < x->size && order [x->vars[i]] < order [y->vars[j]]))
+      vars[k++] = x->vars[i++];
+    else if (i == x->size || order [x->vars[i]] > order [y->vars[j]])
+      vars[k++] = y->vars[j++];
+    else {
+      vars[k++] = x->vars[i++];
+      j++;
+    }
+  }
+  s = uset_intern (vars, k);
+  free (vars);
+
+  u->a = usets [a].stamp;
+  u->b = usets [b].stamp;
+  u->res = usets [s].stamp;
+  u->id = s;
+  return s;
+}
+
+void uset_state (Visit visit) {
+  VISIT (usets);
+  VISIT (num_usets);
+  VISIT (size_usets);
+  VISIT (free_usets);
+  VISIT (stamp);
+  VISIT (order);
+  VISIT (buckets);
+  VISIT (unions);
+  VISIT (buckets_size);
+}
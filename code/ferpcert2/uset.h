@@ -0,0 +1,27 @@
+#ifndef USET_H
+#define USET_H
+
+#include "admin.h"
+
+typedef struct USet USet;
+
+struct USet {
+  int size;
+  int *vars;       // universal variables, sorted by the prefix
+  int refs;        // 0 once released
+  unsigned hash;
+  unsigned stamp;  // distinct for every set a slot holds
+  int next;        // next set in the same bucket, or free slot
+};
+
+extern TLS USet *usets;
+
+void uset_init (int *, unsigned);
+void uset_reset ();
+int uset_intern (int *, int);
+int uset_union (int, int);
+void uset_ref (int);
+void uset_release (int);
+void uset_state (Visit);
+
+#endif
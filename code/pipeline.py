@@ -1,17 +1,31 @@
 #!/usr/bin/env python2
 
-import sys, os, shutil, errno, subprocess, signal
+import sys, os, shutil, errno, subprocess, signal, threading, time, hashlib
 
 home = os.path.dirname(os.path.abspath(__file__)) + "/"
 dependencies = ["ijtihad/ijtihad", "picosat-965/picosat", 
                 "booleforce-1.2/tracecheck", "toferp/toferp", 
-                "ferpcert/ferpcheck", "ferpcert2/ferpcert",
-                "certcheck-1.0.1/certcheck", "cadical/build/cadical"]
+                "ferpcert2/ferpcert", "certcheck-1.0.1/certcheck",
+                "cadical/build/cadical"]
 
 dependencies = [home + x for x in dependencies]
 tmp_dir = home + "tmp/tmp-%d/" % os.getpid()
 
 trim = False
+jobs = 1
+stream = False
+lrat = False
+minimize = None  # time limit for ferpcert --minimize
+times = None     # file to which the run time of each stage is appended
+cache = None     # directory of the stage result cache
+cache_size = 10240  # MB kept in the cache before the least recently used go
+
+# Intermediate files whose producer writes and whose consumers read strictly
+# sequentially; these may be replaced by named pipes.
+streamable = ["tmp.proof2", "tmp.ferp"]
+
+# Strategy before minimisation, the certificate if the minimised one fails
+unminimized = tmp_dir + "unminimized.aig"
 
 def assure_dir(path):
   try:
@@ -23,10 +37,31 @@ def assure_dir(path):
 
 
 def parse_args():
+  global jobs, stream, lrat, minimize, times, cache, cache_size
   sys.stdout.write("Parsing command line arguments ... ")
-  assert len(sys.argv) == 3
-  input_path = os.path.abspath(sys.argv[1])
-  output_path = os.path.abspath(sys.argv[2])
+  args = []
+  for arg in sys.argv[1:]:
+    if arg.startswith("--jobs="):
+      jobs = int(arg[len("--jobs="):])
+    elif arg == "--stream":
+      stream = True
+    elif arg == "--lrat":
+      lrat = True
+    elif arg.startswith("--minimize="):
+      minimize = arg[len("--minimize="):]
+    elif arg.startswith("--times="):
+      times = os.path.abspath(arg[len("--times="):])
+    elif arg.startswith("--cache="):
+      cache = os.path.abspath(arg[len("--cache="):]) + "/"
+    elif arg.startswith("--cache-size="):
+      cache_size = int(arg[len("--cache-size="):])
+    elif arg.startswith("-j"):
+      jobs = int(arg[2:])
+    else:
+      args.append(arg)
+  assert len(args) == 2 and jobs > 0 and cache_size > 0
+  input_path = os.path.abspath(args[0])
+  output_path = os.path.abspath(args[1])
   qbf_name = ".".join(input_path.split("/")[-1].split(".")[:-1])
   output_dir = "/".join(output_path.split("/")[:-1])
   if not os.path.exists(input_path):
@@ -61,6 +96,482 @@ def term_handler(signum, frame):
   clean(-1)
 
 
+def read_qbf(path):
+  prefix, clauses = [], []
+  with open(path) as f:
+    for line in f:
+      tokens = line.split()
+      if not tokens or tokens[0] in ("c", "p"):
+        continue
+      if tokens[0] in ("a", "e"):
+        prefix.append((tokens[0], [int(x) for x in tokens[1:-1]]))
+      else:
+        clauses.append([int(x) for x in tokens[:-1]])
+  return prefix, clauses
+
+
+def select_cube_vars(input_path, num_vars):
+  # Split on the existential inputs of the certificate that occur most often
+  # in the matrix. Outer blocks win ties since the strategy depends on them.
+  prefix, clauses = read_qbf(input_path)
+  count = {}
+  for clause in clauses:
+    for lit in clause:
+      count[abs(lit)] = count.get(abs(lit), 0) + 1
+  candidates = []
+  for level, (qtype, block) in enumerate(prefix):
+    if qtype == "e":
+      candidates += [(-count.get(v, 0), level, v) for v in block]
+  candidates.sort()
+  return [v for _, _, v in candidates[:num_vars]]
+
+
+def feed_cube(cnf_path, cube, proc):
+  # Stream the merged CNF with the cube appended as unit clauses, so no
+  # per-cube copy of the (possibly huge) formula is written to disk.
+  try:
+    with open(cnf_path, "rb") as f:
+      line = f.readline()
+      while line.startswith(b"c"):
+        line = f.readline()
+      header = line.split()
+      assert header[:2] == [b"p", b"cnf"]
+      proc.stdin.write(b"p cnf %d %d\n" % (int(header[2]), int(header[3]) + len(cube)))
+      shutil.copyfileobj(f, proc.stdin, 1 << 20)
+      for lit in cube:
+        proc.stdin.write(b"%d 0\n" % lit)
+    proc.stdin.close()
+  except (IOError, OSError):
+    pass  # solver was killed because another cube already finished
+
+
+def check_cubes(solver, cnf_path, input_path, num_jobs, FNULL):
+  # Cube-and-conquer: 4 cubes per job keep all workers busy when cubes are
+  # unbalanced. Returns 10 on the first SAT cube, 20 if all cubes are UNSAT.
+  depth = 2
+  while (1 << depth) < 4 * num_jobs:
+    depth += 1
+  cube_vars = select_cube_vars(input_path, depth)
+  cubes = []
+  for bits in range(1 << len(cube_vars)):
+    cubes.append([v if (bits >> i) & 1 else -v for i, v in enumerate(cube_vars)])
+
+  running, result = [], 20
+  while (cubes or running) and result == 20:
+    while cubes and len(running) < num_jobs:
+      proc = subprocess.Popen([solver], stdin=subprocess.PIPE,
+                              stdout=FNULL, stderr=FNULL)
+      feeder = threading.Thread(target=feed_cube, args=(cnf_path, cubes.pop(), proc))
+      feeder.daemon = True
+      feeder.start()
+      running.append((proc, feeder))
+    finished = [(p, t) for p, t in running if p.poll() is not None]
+    if not finished:
+      time.sleep(0.05)
+      continue
+    for proc, feeder in finished:
+      running.remove((proc, feeder))
+      if proc.returncode != 20:
+        result = proc.returncode
+        break
+
+  # Cubes polled as finished after the first SAT one were reaped already
+  for proc, feeder in running:
+    if proc.returncode is None:
+      proc.kill()
+    proc.wait()
+  return result
+
+
+class Stage:
+  # A pipeline step. Intermediate files are referred to as "@<name>" in cmd,
+  # where <name> is one of its inputs or outputs, and are resolved to tmp_dir
+  # (or to a FIFO when streaming).
+  # Files written outside tmp_dir, such as the certificate, are results.
+  def __init__(self, message, cmd, inputs=(), outputs=(), results=(), stdout=None,
+               capture=False, quiet=False, verdict=None):
+    self.message, self.cmd = message, cmd
+    self.inputs, self.outputs = list(inputs), list(outputs)
+    self.results = list(results)
+    self.stdout, self.capture, self.quiet = stdout, capture, quiet
+    self.verdict = verdict
+    self.after = []  # stages that must finish first without a file edge
+    self.task = None
+    self.start = None
+    self.key = None     # cache key, None if the stage is not cached
+    self.cached = None  # return code of a cache hit
+
+  def placeholder(self, arg):
+    # (prefix, name) of an argument "<prefix>@<name>" naming an intermediate
+    # file, None for any other argument such as a path containing "@"
+    prefix, at, f = arg.rpartition("@")
+    if at and (f in self.inputs or f in self.outputs):
+      return prefix, f
+    return None
+
+
+class Task:
+  # Uniform handle for stages that run a command or a python function.
+  def __init__(self, cmd, stdout, stderr):
+    self.proc, self.returncode = None, None
+    if callable(cmd):
+      def run():
+        self.returncode = cmd()
+      self.thread = threading.Thread(target=run)
+      self.thread.daemon = True
+      self.thread.start()
+    else:
+      self.proc = subprocess.Popen(cmd, stdout=stdout, stderr=stderr)
+
+  def poll(self):
+    if self.proc is not None:
+      self.returncode = self.proc.poll()
+    return self.returncode
+
+  def kill(self):
+    if self.proc is not None and self.proc.poll() is None:
+      self.proc.kill()
+      self.proc.wait()
+
+
+def exit_code(code):
+  def verdict(ret, out):
+    if ret != 0: return "FAILED", ret, code
+  return verdict
+
+
+def tee(source, branches):
+  # Copy one FIFO into several so that independent consumers read the same
+  # stream concurrently. A consumer that goes away is dropped silently.
+  with open(source, "rb") as src:
+    outs = [open(b, "wb") for b in branches]
+    while outs:
+      chunk = src.read(1 << 20)
+      if not chunk:
+        break
+      for out in list(outs):
+        try:
+          out.write(chunk)
+        except (IOError, OSError):
+          outs.remove(out)
+    for out in outs:
+      try:
+        out.close()
+      except (IOError, OSError):
+        pass
+
+
+digests = {}
+
+def file_digest(path):
+  if path not in digests:
+    h = hashlib.sha256()
+    with open(path, "rb") as f:
+      for chunk in iter(lambda: f.read(1 << 20), b""):
+        h.update(chunk)
+    digests[path] = h.hexdigest()
+  return digests[path]
+
+
+def stage_keys(stages):
+  # Key each stage by its command line in which tools and input files are
+  # replaced by their content hash and files of earlier stages by the key
+  # of their producer, so a key changes with anything upstream. Stages
+  # running python functions and everything after them are not cached.
+  produced = {}
+  for s in stages:
+    tokens = []
+    for arg in ([] if callable(s.cmd) else s.cmd):
+      if s.placeholder(arg):
+        prefix, f = s.placeholder(arg)
+        if f in s.outputs:
+          token = prefix + ">" + f
+        else:
+          token = f in produced and prefix + "@" + produced[f]
+      elif arg in s.results:
+        token = "@result%d" % s.results.index(arg)
+      elif arg in produced:
+        token = "@" + produced[arg]
+      elif os.path.isfile(arg):
+        token = "#" + file_digest(arg)
+      else:
+        token = arg.replace(tmp_dir, "@tmp/")
+      if not token:
+        break
+      tokens.append(token)
+    else:
+      if tokens:
+        tokens += [">" + f for f in s.outputs]
+        s.key = hashlib.sha256("\0".join(tokens).encode("utf-8")).hexdigest()
+        for f in s.outputs + s.results:
+          produced[f] = hashlib.sha256((s.key + f).encode("utf-8")).hexdigest()
+
+
+def cache_files(s, stages, copies=()):
+  # (path, name in the cache entry) of what a stage leaves, where FIFOs in
+  # copies are read from their teed copy
+  files = [(tmp_dir + f + (".cache" if f in copies else ""), f) for f in s.outputs]
+  files += [(f, "result%d" % i) for i, f in enumerate(s.results)]
+  if s.capture:
+    files.append((tmp_dir + "stage%d.out" % stages.index(s), "stdout"))
+  return files
+
+
+def cache_restore(stages):
+  # Copy the artifacts of cache hits back, leaving out intermediate files no
+  # stage that runs reads. If an entry was evicted meanwhile all stages run,
+  # and what was restored is removed first: intermediates are hard links
+  # into the cache, which the rerun stages would otherwise overwrite.
+  hits = [s for s in stages if s.key and os.path.isdir(cache + s.key)]
+  needed = set(f for s in stages if s not in hits for f in s.inputs)
+  restored = []
+  try:
+    for s in hits:
+      entry = cache + s.key
+      with open(entry + "/returncode") as f:
+        s.cached = int(f.read())
+      for path, name in cache_files(s, stages):
+        if name in s.outputs and name not in needed:
+          continue
+        restored.append(path)
+        if name in s.outputs:
+          # Intermediates are only read, the certificate gets gzipped
+          try:
+            os.link(entry + "/" + name, path)
+            continue
+          except OSError:
+            pass
+        shutil.copyfile(entry + "/" + name, path)
+      os.utime(entry, None)
+  except (IOError, OSError, ValueError):
+    for path in restored:
+      if os.path.lexists(path):
+        os.remove(path)
+    for s in hits:
+      s.cached = None
+
+
+def cache_store(s, stages, copies):
+  # Entries are written under a temporary name and renamed, so concurrent
+  # pipelines sharing the cache never see a partial entry.
+  entry = cache + s.key
+  if os.path.isdir(entry):
+    return
+  partial = cache + "tmp-%d-%s" % (os.getpid(), s.key)
+  try:
+    assure_dir(partial)
+    for path, name in cache_files(s, stages, copies):
+      shutil.copyfile(path, partial + "/" + name)
+    with open(partial + "/returncode", "w") as f:
+      f.write("%d\n" % s.task.returncode)
+    os.rename(partial, entry)
+  except (IOError, OSError):
+    shutil.rmtree(partial, ignore_errors=True)
+    return
+  cache_evict()
+
+
+def cache_evict():
+  # Drop the least recently used entries until the cache fits cache_size
+  entries, total = [], 0
+  for name in os.listdir(cache):
+    if name.startswith("tmp-"):
+      continue
+    path, size = cache + name, 0
+    try:
+      for f in os.listdir(path):
+        size += os.path.getsize(path + "/" + f)
+      entries.append((os.path.getmtime(path), size, path))
+    except OSError:
+      continue
+    total += size
+  entries.sort()
+  while entries and total > cache_size << 20:
+    _, size, path = entries.pop(0)
+    shutil.rmtree(path, ignore_errors=True)
+    total -= size
+
+
+def run_stages(stages, FNULL):
+  # Run the stage DAG. Edges are given by the intermediate files. Without
+  # streaming the stages run one after another in the given order. With
+  # streaming, files in streamable are FIFOs whose consumers run concurrently
+  # with the producer, and independent stages overlap; all other files are
+  # complete before any consumer starts. Cache hits finish at once and
+  # neither write nor read FIFOs; a FIFO of a cached stage is also teed
+  # into a file which is stored once the stage is done.
+  producer, consumers = {}, {}
+  for s in stages:
+    for f in s.outputs: producer[f] = s
+    for f in s.inputs: consumers.setdefault(f, []).append(s)
+
+  if cache:
+    assure_dir(cache)
+    stage_keys(stages)
+    cache_restore(stages)
+
+  paths, copies, unstored = {}, {}, []
+  live = lambda f: [s for s in consumers[f] if s.cached is None]
+  fifos = [f for f in streamable if stream and f in producer and f in consumers
+           and producer[f].cached is None and live(f)]
+  for f in fifos:
+    os.mkfifo(tmp_dir + f)
+    if len(live(f)) == 1 and not producer[f].key:
+      continue
+    branches = [tmp_dir + f + ".cache"] if producer[f].key else []
+    for i, s in enumerate(live(f)):
+      branch = tmp_dir + "%s.%d" % (f, i)
+      os.mkfifo(branch)
+      paths[(s, f)] = branch
+      branches.append(branch)
+    thread = threading.Thread(target=tee, args=(tmp_dir + f, branches))
+    thread.daemon = True
+    thread.start()
+    if producer[f].key:
+      copies[f] = thread
+
+  def store(wait):
+    for s in list(unstored):
+      teeing = [copies[f] for f in s.outputs if f in copies]
+      for thread in teeing if wait else []:
+        thread.join()
+      if any(thread.is_alive() for thread in teeing):
+        continue
+      unstored.remove(s)
+      cache_store(s, stages, copies)
+
+  def resolve(s, arg):
+    if not s.placeholder(arg):
+      return arg
+    prefix, f = s.placeholder(arg)
+    return prefix + paths.get((s, f), tmp_dir + f)
+
+  def ready(s):
+    for f in s.inputs:
+      if f not in producer:
+        continue
+      p = producer[f]
+      if p.task is None or (f not in fifos and p.task.poll() is None):
+        return False
+    return all(p.task is not None and p.task.poll() is not None for p in s.after)
+
+  pending, running, removed = list(stages), [], set()
+  while pending or running:
+    for s in list(pending):
+      if not stream and running:
+        break
+      if not ready(s):
+        continue
+      if not stream:
+        sys.stdout.write(s.message + " ... ")
+        sys.stdout.flush()
+      out = FNULL if s.quiet else None
+      if s.stdout is not None and s.cached is None:
+        out = open(tmp_dir + s.stdout, "wb")
+      elif s.capture and s.cached is None:
+        out = open(tmp_dir + "stage%d.out" % stages.index(s), "wb")
+      cmd = s.cmd if callable(s.cmd) else [resolve(s, arg) for arg in s.cmd]
+      if s.cached is not None:
+        cmd = lambda ret=s.cached: ret
+      s.start = time.time()
+      s.task = Task(cmd, out, FNULL if s.quiet else None)
+      if out is not None and out is not FNULL:
+        out.close()
+      pending.remove(s)
+      running.append(s)
+
+    finished = [s for s in running if s.task.poll() is not None]
+    if not finished:
+      time.sleep(0.05)
+      continue
+    for s in finished:
+      running.remove(s)
+      if times:
+        with open(times, "a") as f:
+          f.write("%s\t%.3f\n" % (s.message, time.time() - s.start))
+      out = b""
+      if s.capture:
+        with open(tmp_dir + "stage%d.out" % stages.index(s), "rb") as f:
+          out = f.read()
+      failure = s.verdict(s.task.returncode, out) if s.verdict else None
+      if stream:
+        sys.stdout.write(s.message + " ... ")
+      if failure is not None:
+        status, details, code = failure
+        print(status)
+        print(details)
+        for r in running:
+          r.task.kill()
+        clean(code)
+      if s.key and s.cached is None:
+        unstored.append(s)
+      store(False)
+      if s is not stages[-1]:
+        print("DONE" if s.cached is None else "DONE (cached)")
+      if trim:
+        for f in s.inputs:
+          if f in producer and f not in removed and os.path.exists(tmp_dir + f) and \
+             all(c.task is not None and c.task.poll() is not None for c in consumers[f]):
+            os.remove(tmp_dir + f)
+            removed.add(f)
+  store(True)
+
+
+def ferpcert_options():
+  return ["--minimize=" + minimize, "--unminimized=" + unminimized] if minimize else []
+
+
+def ferpcert_results(output_path):
+  # The unminimised strategy is a result so that cache hits restore it too
+  return [output_path] + ([unminimized] if minimize else [])
+
+
+def add_trace_stages(stages, input_path, output_path, refuted):
+  # Re-solve the expanded CNF with picosat and turn its trace into a FERP
+  # trace for ferpcert
+  stages.append(Stage("Calling SAT solver", [dependencies[1], "-T", "@tmp.proof", "@tmp.cnf"],
+                      inputs=["tmp.cnf"], outputs=["tmp.proof"], verdict=refuted))
+
+  # The SAT solver only produces normal extended tracecheck proofs
+  # Check the proof with tracecheck and extract binary resolution proof
+
+  def resolved(ret, out):
+    if out.strip() != b"resolved 1 root and 1 empty clause": return "FAILED", out.strip(), 5
+
+  stages.append(Stage("Checking unsat proof", [dependencies[2], "-B", "@tmp.proof2", "-c",
+                      "@tmp.cnf", "@tmp.proof"], inputs=["tmp.cnf", "tmp.proof"],
+                      outputs=["tmp.proof2"], capture=True, verdict=resolved))
+
+  # Merge the comment information from the cnf and the binary resolution
+  # proof into a FERP trace.
+
+  stages.append(Stage("Producing FERP trace", [dependencies[3], "@tmp.cnf", "@tmp.proof2", "@tmp.ferp"],
+                      inputs=["tmp.cnf", "tmp.proof2"], outputs=["tmp.ferp"], verdict=exit_code(6)))
+
+  # Extract a circuit for the universals into an AIGER file, checking
+  # whether the FERP trace is consistent while reading it
+
+  stages.append(Stage("Checking FERP trace and extracting strategy", [dependencies[4], "--check"] +
+                      ferpcert_options() + [input_path, "@tmp.ferp", output_path], inputs=["tmp.ferp"],
+                      results=ferpcert_results(output_path), verdict=exit_code(8)))
+
+
+def add_check_stages(stages, input_path, output_path, certified, FNULL):
+  # Merge AIGER and QDIMACS files into a formula checkable by a SAT solver
+
+  stages.append(Stage("Producing CNF", [dependencies[5], input_path, output_path],
+                      stdout="tmp.cnf2", outputs=["tmp.cnf2"], verdict=exit_code(9)))
+  if len(stages) > 1:
+    stages[-1].after.append(stages[-2])
+
+  if jobs > 1:
+    check = lambda: check_cubes(dependencies[6], tmp_dir + "tmp.cnf2", input_path, jobs, FNULL)
+  else:
+    check = [dependencies[6], "@tmp.cnf2"]
+  stages.append(Stage("Check validity of certificate", check, inputs=["tmp.cnf2"],
+                      quiet=True, verdict=certified))
+
+
 def main():
   signal.signal(signal.SIGTERM, term_handler)
   signal.signal(signal.SIGINT, term_handler)
@@ -75,132 +586,64 @@ def main():
 
   # Call the qbf solver and produce the .cnf file
 
-  sys.stdout.write("Calling QBF solver ... ")
-  sys.stdout.flush()
-  ret = subprocess.call([dependencies[0], "--wit_per_call=-1", "--cex_per_call=-1",
-                         "--tmp_dir="+tmp_dir, "--log_phi="+tmp_dir+"tmp.cnf", input_path]) #, stdout=FNULL, stderr=FNULL)
-  if ret == 10:
-    print("DONE")
-    print("The given formula is TRUE.")
-    clean(1)
-  elif ret != 20:
-    print("FAILED")
-    print("There has been an error with code %d" % ret)
-    clean(2)
-  else:
-    print("DONE")
+  def solved(ret, out):
+    if ret == 10: return "DONE", "The given formula is TRUE.", 1
+    if ret != 20: return "FAILED", "There has been an error with code %d" % ret, 2
 
-  assert(os.path.exists(tmp_dir + "tmp.cnf"))
+  stages = [Stage("Calling QBF solver", [dependencies[0], "--wit_per_call=-1", "--cex_per_call=-1",
+                  "--tmp_dir="+tmp_dir, "--log_phi=@tmp.cnf", input_path],
+                  outputs=["tmp.cnf"], verdict=solved)]
 
   # Call the sat solver again on the .cnf file
   # This has to be done because no proof logging can be done in incremental mode
 
-  sys.stdout.write("Calling SAT solver ... ")
-  sys.stdout.flush()
-  ret = subprocess.call([dependencies[1], "-T", tmp_dir+"tmp.proof", tmp_dir+"tmp.cnf"] ) #,
-                        # stdout=FNULL, stderr=FNULL)
-  if ret == 10:
-    print("FAILED")
-    print("The expanded formula is SAT")
-    clean(3)
-  elif ret != 20:
-    print("FAILED")
-    print("There has been an error with code %d" % ret)
-    clean(4)
-  else:
-    print("DONE")
-
-  assert (os.path.exists(tmp_dir + "tmp.proof"))
-
-  # The SAT solver only produces normal extended tracecheck proofs
-  # Check the proof with tracecheck and extract binary resolution proof
-
-  sys.stdout.write("Checking unsat proof ... ")
-  sys.stdout.flush()
-  ret = subprocess.check_output([dependencies[2], "-B", tmp_dir + "tmp.proof2", "-c",
-                                 tmp_dir + "tmp.cnf", tmp_dir + "tmp.proof"])
-  ret = ret.strip()
-  if ret != b"resolved 1 root and 1 empty clause":
-    print("FAILED")
-    print(ret)
-    clean(5)
+  def refuted(ret, out):
+    if ret == 10: return "FAILED", "The expanded formula is SAT", 3
+    if ret != 20: return "FAILED", "There has been an error with code %d" % ret, 4
+
+  if lrat:
+    # CaDiCaL's LRAT proof is read by ferpcert directly together with the
+    # expansion comments of the .cnf file
+
+    stages.append(Stage("Calling SAT solver", [dependencies[6], "--lrat", "--no-binary",
+                        "@tmp.cnf", "@tmp.lrat"], inputs=["tmp.cnf"], outputs=["tmp.lrat"],
+                        quiet=True, verdict=refuted))
+    stages.append(Stage("Checking proof and extracting strategy", [dependencies[4], "--check",
+                        "--cnf=@tmp.cnf", "--lrat"] + ferpcert_options() +
+                        [input_path, "@tmp.lrat", output_path],
+                        inputs=["tmp.cnf", "tmp.lrat"], results=ferpcert_results(output_path),
+                        verdict=exit_code(8)))
   else:
-    if trim: os.remove(tmp_dir + "tmp.proof")
-    print("DONE")
-  
-  assert (os.path.exists(tmp_dir + "tmp.proof2"))
-  
-  # Merge the comment information from the cnf and the binary resolution
-  # proof into a FERP trace.
+    add_trace_stages(stages, input_path, output_path, refuted)
 
-  sys.stdout.write("Producing FERP trace ... ")
-  sys.stdout.flush()
-  ret = subprocess.call([dependencies[3], tmp_dir + "tmp.cnf", tmp_dir + "tmp.proof2", tmp_dir + "tmp.ferp"])
+  def certified(ret, out):
+    if ret == 10: return "FAILED", "The merged formula is SAT", 10
+    if ret != 20: return "FAILED", "There has been an error with code %d" % ret, 11
 
-  if ret != 0:
-    print("FAILED", ret)
-    clean(6)
-  else:
-    if trim: os.remove(tmp_dir + "tmp.cnf")
-    if trim: os.remove(tmp_dir + "tmp.proof2")
-    print("DONE")
+  # ferpcert does not always verify a minimised strategy within its time
+  # limit, so one that fails the check is replaced by the unminimised one
 
-  # Check whether the FERP trace is consistent
+  rejected = []
 
-  sys.stdout.write("Checking FERP trace ... ")
-  sys.stdout.flush()
-  ret = subprocess.call([dependencies[4], input_path, tmp_dir + "tmp.ferp"])
+  def minimized_certified(ret, out):
+    if ret != 10: return certified(ret, out)
+    rejected.append(ret)
 
-  if ret != 0:
-    print("FAILED", ret)
-    clean(7)
-  else:
-    print("DONE")
-
-  # Extract a circuit for the universals into an AIGER file
-
-  sys.stdout.write("Extracting strategy ... ")
-  sys.stdout.flush()
-  ret = subprocess.call([dependencies[5], input_path, tmp_dir + "tmp.ferp", output_path])
-
-  if ret != 0:
-    print("FAILED", ret)
-    clean(8)
-  else:
-    if trim: os.remove(tmp_dir + "tmp.ferp")
-    print("DONE")
-
-  # Merge AIGER and QDIMACS files into a formula checkable by a SAT solver
-
-  sys.stdout.write("Producing CNF ... ")
-  sys.stdout.flush()
-
-  FCNF = open(tmp_dir + "tmp.cnf2", "wb")
-  ret = subprocess.call([dependencies[6], input_path, output_path], stdout=FCNF)
-  FCNF.close()
-  
-  if ret != 0:
-    print("FAILED", ret)
-    clean(9)
-  else:
-    print("DONE")
-
-  sys.stdout.write("Check validity of certificate ... ")
-  sys.stdout.flush()
-  ret = subprocess.call([dependencies[7], tmp_dir + "tmp.cnf2"],
-                        stdout=FNULL, stderr=FNULL)
-  if ret == 10:
-    print("FAILED")
-    print("The merged formula is SAT")
-    clean(10)
-  elif ret != 20:
+  add_check_stages(stages, input_path, output_path,
+                   minimized_certified if minimize else certified, FNULL)
+  run_stages(stages, FNULL)
+  if rejected:
     print("FAILED")
-    print("There has been an error with code %d" % ret)
-    clean(11)
-  else:
-    print("SUCCESS")
-    subprocess.call(["gzip", output_path])
-    clean(0)
+    print("The minimised strategy is invalid, falling back to the unminimised one")
+    shutil.copyfile(unminimized, output_path)
+    if os.path.exists(tmp_dir + "tmp.cnf2"):
+      os.remove(tmp_dir + "tmp.cnf2")
+    stages = []
+    add_check_stages(stages, input_path, output_path, certified, FNULL)
+    run_stages(stages, FNULL)
+  print("SUCCESS")
+  subprocess.call(["gzip", output_path])
+  clean(0)
 
 
 if __name__ == '__main__':
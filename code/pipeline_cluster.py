@@ -12,6 +12,7 @@ dependencies = [home + x for x in dependencies]
 tmp_dir = os.getenv("TMPDIR")
 
 trim = False
+stats = None  # file to which each stage's run time and peak RSS are appended
 
 def get_aiger_gates(aiger_file):
   with open(aiger_file, "r") as f:
@@ -30,9 +31,13 @@ def assure_dir(path):
 
 
 def parse_args():
+  global stats
   sys.stdout.write("Parsing command line arguments ... ")
-  assert len(sys.argv) == 2
-  input_path = os.path.abspath(sys.argv[1])
+  args = sys.argv[1:]
+  if args and args[0].startswith("--stats="):
+    stats = os.path.abspath(args.pop(0)[len("--stats="):])
+  assert len(args) == 1
+  input_path = os.path.abspath(args[0])
   output_path = os.path.join(tmp_dir, "output.aig")
   qbf_name = ".".join(input_path.split("/")[-1].split(".")[:-1])
   output_dir = "/".join(output_path.split("/")[:-1])
@@ -68,6 +73,20 @@ def term_handler(signum, frame):
   clean(-1)
 
 
+def run(stage, cmd, stdout=None, stderr=None):
+  # subprocess.call that also records the run time and the peak RSS of the
+  # stage for the batch scheduler. With stdout=PIPE the output is returned.
+  start = time.time()
+  proc = subprocess.Popen(cmd, stdout=stdout, stderr=stderr)
+  out = proc.stdout.read() if stdout == subprocess.PIPE else None
+  _, status, usage = os.wait4(proc.pid, 0)
+  proc.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+  if stats:
+    with open(stats, "a") as f:
+      f.write("%s\t%.3f\t%d\n" % (stage, time.time() - start, usage.ru_maxrss // 1024))
+  return proc.returncode if out is None else (proc.returncode, out)
+
+
 def main():
   signal.signal(signal.SIGTERM, term_handler)
   signal.signal(signal.SIGINT, term_handler)
@@ -85,7 +104,7 @@ def main():
   sys.stdout.write("Calling QBF solver ... ")
   sys.stdout.flush()
   start_time = time.time()
-  ret = subprocess.call([dependencies[0], "--wit_per_call=-1", "--cex_per_call=-1",
+  ret = run("solving", [dependencies[0], "--wit_per_call=-1", "--cex_per_call=-1",
                          "--tmp_dir="+tmp_dir, "--log_phi="+tmp_dir+"/tmp.cnf", input_path]) #, stdout=FNULL, stderr=FNULL)
   if ret == 10:
     print("DONE")
@@ -105,7 +124,7 @@ def main():
 
   sys.stdout.write("Calling SAT solver ... ")
   sys.stdout.flush()
-  ret = subprocess.call([dependencies[1], "-T", tmp_dir+"/tmp.proof", tmp_dir+"/tmp.cnf"] ) #,
+  ret = run("proof", [dependencies[1], "-T", tmp_dir+"/tmp.proof", tmp_dir+"/tmp.cnf"] ) #,
                         # stdout=FNULL, stderr=FNULL)
   if ret == 10:
     print("FAILED")
@@ -125,8 +144,8 @@ def main():
 
   sys.stdout.write("Checking unsat proof ... ")
   sys.stdout.flush()
-  ret = subprocess.check_output([dependencies[2], "-B", tmp_dir + "/tmp.proof2", "-c",
-                                 tmp_dir + "/tmp.cnf", tmp_dir + "/tmp.proof"])
+  _, ret = run("tracecheck", [dependencies[2], "-B", tmp_dir + "/tmp.proof2", "-c",
+                               tmp_dir + "/tmp.cnf", tmp_dir + "/tmp.proof"], stdout=subprocess.PIPE)
   print("Time for QBF Solving: ", time.time() - start_time)
   ret = ret.strip()
   if ret != b"resolved 1 root and 1 empty clause":
@@ -145,7 +164,7 @@ def main():
   sys.stdout.write("Producing FERP trace ... ")
   sys.stdout.flush()
   start_time = time.time()
-  ret = subprocess.call([dependencies[3], tmp_dir + "/tmp.cnf", tmp_dir + "/tmp.proof2", tmp_dir + "/tmp.ferp"])
+  ret = run("toferp", [dependencies[3], tmp_dir + "/tmp.cnf", tmp_dir + "/tmp.proof2", tmp_dir + "/tmp.ferp"])
 
   if ret != 0:
     print("FAILED", ret)
@@ -159,7 +178,7 @@ def main():
 
   sys.stdout.write("Checking FERP trace ... ")
   sys.stdout.flush()
-  ret = subprocess.call([dependencies[4], input_path, tmp_dir + "/tmp.ferp"])
+  ret = run("ferpcheck", [dependencies[4], input_path, tmp_dir + "/tmp.ferp"])
   print("Time for generating and checking FERP Trace: ", time.time() - start_time)
 
   if ret != 0:
@@ -173,7 +192,7 @@ def main():
   sys.stdout.write("Extracting strategy ... ")
   sys.stdout.flush()
   start_time = time.time()
-  ret = subprocess.call([dependencies[5], input_path, tmp_dir + "/tmp.ferp", output_path])
+  ret = run("ferpcert", [dependencies[5], input_path, tmp_dir + "/tmp.ferp", output_path])
 
   if ret != 0:
     print("FAILED", ret)
@@ -193,7 +212,7 @@ def main():
   sys.stdout.flush()
 
   FCNF = open(tmp_dir + "/tmp.cnf2", "wb")
-  ret = subprocess.call([dependencies[6], input_path, output_path], stdout=FCNF)
+  ret = run("merging", [dependencies[6], input_path, output_path], stdout=FCNF)
   FCNF.close()
   
   if ret != 0:
@@ -205,8 +224,8 @@ def main():
   sys.stdout.write("Check validity of certificate ... ")
   sys.stdout.flush()
   start_time = time.time()
-  ret = subprocess.call([dependencies[7], tmp_dir + "/tmp.cnf2"],
-                        stdout=FNULL, stderr=FNULL)
+  ret = run("checking", [dependencies[7], tmp_dir + "/tmp.cnf2"],
+            stdout=FNULL, stderr=FNULL)
   print("Time for checking validity of certificate: ", time.time() - start_time)
   if ret == 10:
     print("FAILED")
@@ -222,5 +241,197 @@ def main():
     clean(0)
 
 
+# Batch mode: runs the pipeline on many formulas concurrently on one node.
+# A pipeline is admitted when the memory reserved by the running ones plus
+# its predicted peak fits the budget. The reservation of a running pipeline
+# is the larger of its current RSS and the highest peak its remaining stages
+# had in earlier runs (the history). Formulas predicted to take longest are
+# started first, which shortens the makespan.
+
+class Job:
+  def __init__(self, name, path, size):
+    self.name, self.path, self.size = name, path, size
+    self.proc = self.start = None
+    self.rss, self.timeout = 0, False
+
+
+def read_history(path):
+  # {name: {stage: (seconds, peak MB)}}, later lines override earlier ones
+  history = {}
+  if os.path.isfile(path):
+    with open(path) as f:
+      for line in f:
+        name, stage, seconds, peak = line.split("\t")
+        history.setdefault(name, {})[stage] = (float(seconds), int(peak))
+  return history
+
+
+def read_stats(path):
+  res = {}
+  if os.path.isfile(path):
+    with open(path) as f:
+      for line in f:
+        stage, seconds, peak = line.split("\t")
+        res[stage] = (float(seconds), int(peak))
+  return res
+
+
+def batch_formulas(path):
+  # A directory of formulas or a list with one formula per line, relative
+  # to the directory of the list
+  if os.path.isdir(path):
+    files = [os.path.join(path, f) for f in sorted(os.listdir(path))
+             if f.endswith(".qdimacs") or f.endswith(".qdimacs.gz")]
+  else:
+    base = os.path.dirname(os.path.abspath(path))
+    with open(path) as f:
+      files = [os.path.join(base, l.strip()) for l in f
+               if l.strip().endswith(".qdimacs") or l.strip().endswith(".qdimacs.gz")]
+  return [Job(".".join(os.path.basename(f).split(".")[:-1]), f, os.path.getsize(f))
+          for f in files if os.path.isfile(f)]
+
+
+def group_rss():
+  # Current RSS in MB of every process group
+  rss, page = {}, os.sysconf("SC_PAGE_SIZE")
+  for pid in os.listdir("/proc"):
+    if not pid.isdigit():
+      continue
+    try:
+      with open("/proc/%s/stat" % pid) as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    except (IOError, OSError, IndexError):
+      continue
+    pgrp = int(fields[2])
+    rss[pgrp] = rss.get(pgrp, 0) + int(fields[21]) * page // (1 << 20)
+  return rss
+
+
+def memory_total():
+  with open("/proc/meminfo") as f:
+    for line in f:
+      if line.startswith("MemTotal:"):
+        return int(line.split()[1]) // 1024
+  return 0
+
+
+def batch():
+  jobs = os.sysconf("SC_NPROCESSORS_ONLN")
+  space_limit = memory_total()  # MB for all running pipelines together
+  time_limit = None             # seconds per formula
+  work_dir = home + "tmp/batch-%d/" % os.getpid()
+  history_path = home + "tmp/batch.history"
+  list_path = None
+  for arg in sys.argv[1:]:
+    if arg.startswith("--batch="):
+      list_path = arg[len("--batch="):]
+    elif arg.startswith("--jobs="):
+      jobs = int(arg[len("--jobs="):])
+    elif arg.startswith("--space-limit="):
+      space_limit = int(arg[len("--space-limit="):])
+    elif arg.startswith("--time-limit="):
+      time_limit = float(arg[len("--time-limit="):])
+    elif arg.startswith("--history="):
+      history_path = os.path.abspath(arg[len("--history="):])
+    elif arg.startswith("--work="):
+      work_dir = os.path.abspath(arg[len("--work="):]) + "/"
+    else:
+      raise OSError("Unknown option %s" % arg)
+  assert list_path and jobs > 0 and space_limit > 0
+  check_dependencies()
+  assure_dir(work_dir)
+  assure_dir(os.path.dirname(history_path))
+  history = read_history(history_path)
+  queue = batch_formulas(list_path)
+
+  # Unknown formulas are predicted from their size by the median ratio of
+  # the known ones, or get an equal share of the budget without history
+  known = [(j, history[j.name]) for j in queue if j.name in history and j.size]
+  def median(values, default):
+    values = sorted(values)
+    return values[len(values) // 2] if values else default
+  peak_ratio = median([max(p for _, p in h.values()) / float(j.size) for j, h in known], None)
+  time_ratio = median([sum(t for t, _ in h.values()) / float(j.size) for j, h in known], 1.0)
+
+  def peak(job, done=()):
+    if job.name in history:
+      return max([p for s, (_, p) in history[job.name].items() if s not in done] or [0])
+    if peak_ratio is None:
+      return space_limit // jobs
+    return int(job.size * peak_ratio)
+
+  def seconds(job):
+    if job.name in history:
+      return sum(t for t, _ in history[job.name].values())
+    return job.size * time_ratio
+
+  queue.sort(key=seconds, reverse=True)
+  print("Scheduling %d formulas on %d jobs within %d MB" % (len(queue), jobs, space_limit))
+
+  running, failed = [], 0
+  while queue or running:
+    rss = group_rss()
+    reserved = 0
+    for job in running:
+      job.rss = max(job.rss, rss.get(job.proc.pid, 0))
+      reserved += max(rss.get(job.proc.pid, 0),
+                      peak(job, read_stats(work_dir + job.name + "/stats")))
+
+    # Admit in order of predicted run time. The first job that does not fit
+    # keeps its predicted peak reserved, so smaller jobs only pass it within
+    # what is left and it starts once enough memory is free; a job that fits
+    # nowhere runs alone
+    waiting = 0
+    for job in list(queue):
+      if len(running) >= jobs:
+        break
+      if running and reserved + waiting + peak(job) > space_limit:
+        waiting = waiting or peak(job)
+        continue
+      tmp = work_dir + job.name + "/"
+      assure_dir(tmp)
+      env = dict(os.environ, TMPDIR=tmp)
+      with open(tmp + "log", "wb") as log:
+        job.proc = subprocess.Popen([sys.executable, os.path.abspath(__file__),
+                                     "--stats=" + tmp + "stats", job.path],
+                                    stdout=log, stderr=subprocess.STDOUT, env=env,
+                                    preexec_fn=os.setsid)
+      job.start = time.time()
+      reserved += peak(job)
+      queue.remove(job)
+      running.append(job)
+
+    for job in list(running):
+      if time_limit and time.time() - job.start > time_limit and not job.timeout:
+        job.timeout = True
+        os.killpg(job.proc.pid, signal.SIGKILL)
+      if job.proc.poll() is None:
+        continue
+      running.remove(job)
+      try:
+        os.killpg(job.proc.pid, signal.SIGKILL)  # stray children of a failed stage
+      except OSError:
+        pass
+      ret = job.proc.returncode
+      status = "ok" if ret == 0 else "true" if ret == 1 else "failed %d" % ret
+      if job.timeout:
+        status = "out of time"
+      failed += ret not in (0, 1)
+      done = read_stats(work_dir + job.name + "/stats")
+      with open(history_path, "a") as f:
+        for stage, (t, p) in sorted(done.items()):
+          f.write("%s\t%s\t%.3f\t%d\n" % (job.name, stage, t, p))
+          job.rss = max(job.rss, p)
+      print("%-50s %12s %10.2f s %8d MB" % (job.name[:50], status,
+                                           time.time() - job.start, job.rss))
+      sys.stdout.flush()
+    time.sleep(0.1)
+  print("Results are in %s" % work_dir)
+  sys.exit(1 if failed else 0)
+
+
 if __name__ == '__main__':
-  main()
+  if any(arg.startswith("--batch=") for arg in sys.argv[1:]):
+    batch()
+  else:
+    main()